@@ -0,0 +1,63 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_BENCH_H
+#define GECS_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+namespace gecs::bench {
+
+/*
+ * Runs fn the given number of times and prints the fastest run in
+ * milliseconds. The fastest run is the one least disturbed by the rest of
+ * the machine.
+ */
+template<typename Func>
+double measure(const char* name, int runs, Func&& fn) {
+	std::vector<double> times;
+	times.reserve(runs);
+	for (int i = 0; i < runs; i++) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	double best = *std::min_element(times.begin(), times.end());
+	std::printf("%-40s %10.3f ms\n", name, best);
+	return best;
+}
+
+// Like measure, with setup run before every run and left out of the time
+template<typename Setup, typename Func>
+double measure(const char* name, int runs, Setup&& setup, Func&& fn) {
+	std::vector<double> times;
+	times.reserve(runs);
+	for (int i = 0; i < runs; i++) {
+		setup();
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	double best = *std::min_element(times.begin(), times.end());
+	std::printf("%-40s %10.3f ms\n", name, best);
+	return best;
+}
+
+// Keeps the compiler from dropping a result nobody reads
+inline volatile size_t sink = 0;
+
+template<typename T>
+void keep(const T& value) {
+	sink = sink + (value != T{});
+}
+
+}
+
+#endif//GECS_BENCH_H
@@ -0,0 +1,81 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "Bench.h"
+#include "ecs/Entity.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+using namespace gecs;
+
+static constexpr size_t ENTITY_COUNT = 100000;
+static constexpr size_t CHILD_COUNT = 10000;
+
+// Removal before slots were recorded: find the handle, then erase it
+static void eraseByScan(std::vector<entt::entity>& list, entt::entity handle) {
+	auto it = std::find(list.begin(), list.end(), handle);
+	if (it != list.end()) {
+		list.erase(it);
+	}
+}
+
+int main() {
+	std::mt19937 random(42);
+	std::unique_ptr<Scene> scene;
+	std::vector<entt::entity> handles;
+	std::vector<entt::entity> hierarchy;
+
+	std::printf("%zu entities removed in random order\n", ENTITY_COUNT);
+	bench::measure("Scene::removeEntities + destroy", 5, [&]() {
+		scene = std::make_unique<Scene>();
+		handles = scene->createEntities(ENTITY_COUNT, "Bullet");
+		std::shuffle(handles.begin(), handles.end(), random);
+	}, [&]() {
+		scene->removeEntities(handles.begin(), handles.end());
+		scene->processDestroyQueue();
+	});
+	bench::measure("find and erase in the hierarchy list", 1, [&]() {
+		hierarchy.resize(ENTITY_COUNT);
+		for (size_t i = 0; i < ENTITY_COUNT; i++) {
+			hierarchy[i] = static_cast<entt::entity>(i);
+		}
+		handles = hierarchy;
+		std::shuffle(handles.begin(), handles.end(), random);
+	}, [&]() {
+		for (entt::entity handle : handles) {
+			eraseByScan(hierarchy, handle);
+		}
+	});
+
+	std::printf("%zu children of one parent removed in random order\n", CHILD_COUNT);
+	bench::measure("Scene::removeEntities + destroy, children", 5, [&]() {
+		scene = std::make_unique<Scene>();
+		entt::entity parent = scene->createEntity("Parent");
+		handles = scene->createEntities(CHILD_COUNT, "Child");
+		for (entt::entity child : handles) {
+			scene->linkEntities(parent, child);
+		}
+		std::shuffle(handles.begin(), handles.end(), random);
+	}, [&]() {
+		scene->removeEntities(handles.begin(), handles.end());
+		scene->processDestroyQueue();
+	});
+	std::vector<entt::entity> childs;
+	bench::measure("find and erase in the child list", 5, [&]() {
+		childs.resize(CHILD_COUNT);
+		for (size_t i = 0; i < CHILD_COUNT; i++) {
+			childs[i] = static_cast<entt::entity>(i);
+		}
+		handles = childs;
+		std::shuffle(handles.begin(), handles.end(), random);
+	}, [&]() {
+		// Each removal scanned the parent's childs and the scene hierarchy
+		for (entt::entity handle : handles) {
+			eraseByScan(childs, handle);
+		}
+	});
+	return 0;
+}
@@ -0,0 +1,62 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "Bench.h"
+#include "ecs/Entity.h"
+
+using namespace gecs;
+
+static constexpr size_t ENTITY_COUNT = 100000;
+static constexpr size_t PARENT_COUNT = 1000;
+
+/*
+ * What the Entity constructor did before it became a plain handle: look up
+ * the TreeComponent and cache the parent and the child list.
+ */
+struct LookupEntity {
+	template<typename Trees>
+	LookupEntity(entt::entity handle, Scene* scene, Trees& trees) : handle(handle), scene(scene) {
+		if (trees.contains(handle)) {
+			TreeComponent& tree = trees.template get<TreeComponent>(handle);
+			parenthandle = tree.parent;
+			childhandles = &tree.childs;
+		}
+	}
+
+	entt::entity handle;
+	Scene* scene;
+	entt::entity parenthandle = entt::null;
+	std::vector<entt::entity>* childhandles = nullptr;
+};
+
+int main() {
+	Scene scene;
+	std::vector<entt::entity> parents = scene.createEntities(PARENT_COUNT, "Parent");
+	std::vector<entt::entity> children = scene.createEntities(ENTITY_COUNT - PARENT_COUNT, "Child");
+	// Half of the children are in a hierarchy, like a scene with props and rigs
+	for (size_t i = 0; i < children.size(); i += 2) {
+		scene.linkEntities(parents[i % PARENT_COUNT], children[i]);
+	}
+
+	auto transforms = scene.getAllEntitiesWith<TransformComponent>();
+	auto trees = scene.getAllEntitiesWith<TreeComponent>();
+	std::printf("%zu entities, %zu in a hierarchy\n", ENTITY_COUNT, trees.size());
+	bench::measure("Entity per entity", 20, [&]() {
+		size_t sum = 0;
+		for (entt::entity handle : transforms) {
+			Entity entity{handle, &scene};
+			sum += static_cast<uint32_t>(entity);
+		}
+		bench::keep(sum);
+	});
+	bench::measure("Entity with TreeComponent lookup", 20, [&]() {
+		size_t sum = 0;
+		for (entt::entity handle : transforms) {
+			LookupEntity entity{handle, &scene, trees};
+			sum += static_cast<uint32_t>(entity.handle) + (entity.childhandles != nullptr);
+		}
+		bench::keep(sum);
+	});
+	return 0;
+}
@@ -0,0 +1,74 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "Bench.h"
+#include "ecs/SpatialIndex.h"
+
+#include <random>
+
+using namespace gecs;
+
+static constexpr int ENTITY_COUNT = 20000;
+static constexpr int QUERY_COUNT = 200;
+
+int main() {
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+	std::vector<entt::entity> handles(ENTITY_COUNT);
+	std::vector<Aabb> boxes(ENTITY_COUNT);
+	SpatialIndex index;
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		handles[i] = static_cast<entt::entity>(i);
+		glm::vec3 min(position(random), position(random), position(random));
+		boxes[i] = {min, min + glm::vec3(size(random))};
+		index.update(handles[i], boxes[i]);
+	}
+	std::vector<Aabb> queries(QUERY_COUNT);
+	for (Aabb& query : queries) {
+		glm::vec3 min(position(random), position(random), position(random));
+		query = {min, min + glm::vec3(50.0f)};
+	}
+
+	std::printf("%d boxes, %d aabb queries\n", ENTITY_COUNT, QUERY_COUNT);
+	size_t treehits = 0;
+	size_t brutehits = 0;
+	std::vector<entt::entity> results;
+	bench::measure("SpatialIndex::queryAabb", 10, [&]() {
+		treehits = 0;
+		for (const Aabb& query : queries) {
+			index.queryAabb(query, results);
+			treehits += results.size();
+		}
+	});
+	bench::measure("brute force", 10, [&]() {
+		brutehits = 0;
+		for (const Aabb& query : queries) {
+			results.clear();
+			for (int i = 0; i < ENTITY_COUNT; i++) {
+				if (boxes[i].overlaps(query)) {
+					results.push_back(handles[i]);
+				}
+			}
+			brutehits += results.size();
+		}
+	});
+	bench::keep(treehits + brutehits);
+	if (treehits != brutehits) {
+		std::printf("mismatch: %zu hits through the tree, %zu by brute force\n", treehits, brutehits);
+		return 1;
+	}
+
+	// Moving every box a little, most leaves stay inside their enlarged box
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	bench::measure("SpatialIndex::update, small moves", 10, [&]() {
+		for (int i = 0; i < ENTITY_COUNT; i++) {
+			glm::vec3 offset(step(random), step(random), step(random));
+			boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+			index.update(handles[i], boxes[i]);
+		}
+	});
+	return 0;
+}
@@ -0,0 +1,90 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "Bench.h"
+#include "ecs/TransformKernel.h"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+using namespace gecs;
+
+static constexpr size_t TRANSFORM_COUNT = 100000;
+
+struct Transform {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+	glm::vec3 pivot;
+};
+
+// The transform pass before TransformKernel: five matrix products and an inverse per transform
+static void computeByProducts(const Transform& t, glm::mat4& matrix, glm::mat3& normalmatrix) {
+	glm::mat4 translation = glm::translate(glm::mat4(1.0f), t.position);
+	glm::mat4 pivot = glm::translate(glm::mat4(1.0f), t.pivot);
+	glm::mat4 unpivot = glm::translate(glm::mat4(1.0f), -t.pivot);
+	glm::mat4 scale = glm::scale(glm::mat4(1.0f), t.scale);
+	matrix = translation * pivot * glm::mat4_cast(t.rotation) * scale * unpivot;
+	normalmatrix = glm::inverseTranspose(glm::mat3(matrix));
+}
+
+int main() {
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+	std::vector<Transform> transforms(TRANSFORM_COUNT);
+	for (Transform& t : transforms) {
+		t.position = glm::vec3(value(random), value(random), value(random));
+		t.rotation = glm::normalize(glm::quat(value(random), value(random), value(random), value(random)));
+		t.scale = glm::vec3(scale(random), scale(random), scale(random));
+		t.pivot = glm::vec3(value(random), value(random), value(random));
+	}
+	std::vector<glm::mat4> matrices(TRANSFORM_COUNT);
+	std::vector<glm::mat3> normalmatrices(TRANSFORM_COUNT);
+
+	std::printf("%zu transforms\n", TRANSFORM_COUNT);
+	bench::measure("matrix products + inverseTranspose", 20, [&]() {
+		for (size_t i = 0; i < TRANSFORM_COUNT; i++) {
+			computeByProducts(transforms[i], matrices[i], normalmatrices[i]);
+		}
+		bench::keep(matrices.back()[3][0]);
+	});
+
+	TransformKernel kernel;
+	kernel.reserve(TRANSFORM_COUNT);
+	auto gather = [&]() {
+		kernel.clear();
+		for (const Transform& t : transforms) {
+			kernel.add(t.position, t.rotation, t.scale, t.pivot);
+		}
+	};
+	gather();
+	bench::measure("TransformKernel::compute", 20, [&]() {
+		kernel.compute();
+	});
+	bench::measure("TransformKernel, gather and write back", 20, [&]() {
+		gather();
+		kernel.compute();
+		for (size_t i = 0; i < TRANSFORM_COUNT; i++) {
+			kernel.getMatrices(i, matrices[i], normalmatrices[i]);
+		}
+		bench::keep(matrices.back()[3][0]);
+	});
+
+	// Both paths must agree before their times mean anything
+	glm::mat4 expected;
+	glm::mat3 expectednormal;
+	for (size_t i = 0; i < TRANSFORM_COUNT; i++) {
+		computeByProducts(transforms[i], expected, expectednormal);
+		for (int column = 0; column < 4; column++) {
+			glm::vec4 difference = glm::abs(expected[column] - matrices[i][column]);
+			if (glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)) > 1e-3f) {
+				std::printf("transform %zu differs\n", i);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -7,6 +7,15 @@
 
 #include "gImage.h"
 #include "gSkybox.h"
+#include "ecs/MappedFile.h"
+#include "ecs/TextureAtlas.h"
+#include "ecs/ThreadPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace gecs {
 
@@ -20,10 +29,15 @@ public:
 	AssetBase(AssetType type)
 		: type(type) {
 	}
+	virtual ~AssetBase() = default;
+
+	AssetType getType() const { return type; }
+
+	// bytes of decoded pixel data held on the CPU
+	virtual size_t getByteSize() const = 0;
 
 private:
 	AssetType type;
-	std::string assetpath;
 };
 
 struct ImageData {
@@ -32,6 +46,8 @@ struct ImageData {
 	int channels;
 	bool ishdr;
 	void* image;
+	// Set when image points into a mapped baked file instead of stbi memory
+	std::shared_ptr<MappedFile> mapping;
 
 	ImageData() : width(0), height(0), channels(0), ishdr(false), image(nullptr) {
 	}
@@ -49,13 +65,26 @@ struct ImageData {
 		channels = data.channels;
 		ishdr = data.ishdr;
 		image = data.image;
+		mapping = std::move(data.mapping);
 		data.image = nullptr;
 	}
-	~ImageData() {
-		if (image) {
+
+	size_t getByteSize() const {
+		size_t texel = ishdr ? sizeof(float) : sizeof(unsigned char);
+		return image ? static_cast<size_t>(width) * height * channels * texel : 0;
+	}
+
+	// Frees the pixels, the size is kept
+	void release() {
+		if (image && !mapping) {
 			stbi_image_free(image);
-			image = nullptr;
 		}
+		image = nullptr;
+		mapping.reset();
+	}
+
+	~ImageData() {
+		release();
 	}
 };
 
@@ -64,11 +93,32 @@ public:
 	explicit SpriteAsset(ImageData data)
 		: AssetBase(AssetType::STATIC_SPRITE), data(std::move(data)) {
 	}
+	// Gives the atlas rect back to its page
+	~SpriteAsset() override;
 
+	// Packed assets copy their rect out of the atlas page, as RGBA
 	void applyTo(gImage& image);
+	size_t getByteSize() const override { return data.getByteSize() + regionpixels.size(); }
+
+	/*
+	 * Texture uploaded from this asset, created on first use. Every sprite
+	 * using the asset shares it. For packed assets this is the atlas page.
+	 * Must be called from the main thread.
+	 */
+	std::shared_ptr<gImage> getTexture();
+
+	// Invalid unless AssetsManager packed the asset into its atlas
+	const AtlasRegion& getAtlasRegion() const { return region; }
 
 private:
-	const ImageData data;
+	friend class AssetsManager;
+
+	// released once the asset is packed into the atlas
+	ImageData data;
+	std::shared_ptr<gImage> texture;
+	AtlasRegion region;
+	// pixels of the atlas rect handed to images by applyTo, which don't copy them
+	std::vector<unsigned char> regionpixels;
 };
 
 class SkyboxAsset : public AssetBase {
@@ -77,21 +127,184 @@ public:
 	}
 
 	void applyTo(gSkybox& skybox);
+	size_t getByteSize() const override;
 
 private:
 	std::array<ImageData, 6> faces;
 };
 
+enum class AssetState {
+	LOADING,
+	LOADED,
+	FAILED,
+};
+
+/*
+ * Result of an asynchronous load. The asset becomes available once
+ * AssetsManager::processLoadQueue() picked it up on the main thread.
+ * A loaded handle counts as a user of its asset.
+ */
+class AssetHandle {
+public:
+	using Callback = std::function<void(std::shared_ptr<AssetBase>)>;
+
+	AssetHandle() = default;
+
+	AssetState getState() const;
+	bool isValid() const { return state != nullptr; }
+	bool isDone() const { return getState() != AssetState::LOADING; }
+	bool isLoaded() const { return getState() == AssetState::LOADED; }
+
+	// null until the asset is loaded
+	std::shared_ptr<AssetBase> get() const;
+
+	template<typename T>
+	std::shared_ptr<T> getAs() const {
+		return std::static_pointer_cast<T>(get());
+	}
+
+	/*
+	 * Runs callback on the main thread once the asset is loaded, right away
+	 * if it already is. Not called when the load fails.
+	 */
+	void onLoaded(Callback callback) const;
+
+private:
+	friend class AssetsManager;
+
+	struct State {
+		std::atomic<AssetState> state{AssetState::LOADING};
+		std::shared_ptr<AssetBase> asset;
+		// only touched from the main thread
+		std::vector<Callback> callbacks;
+	};
+
+	explicit AssetHandle(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+	std::shared_ptr<State> state;
+};
+
+struct AssetCacheStats {
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
+	// decoded bytes currently held by the cache, atlas pages included
+	size_t residentbytes = 0;
+};
+
+/*
+ * Assets are cached by content, loading a file that is already cached under
+ * another path or ref returns the same asset. Assets that nobody but the
+ * cache holds are evicted, least recently used first, once the decoded data
+ * exceeds the memory budget. An evicted asset is decoded again the next time
+ * it is requested. Only the loader threads run off the main thread.
+ */
 class AssetsManager {
 public:
-	AssetsManager();
+	// loadercount threads decode async loads, 0 decodes them on the calling thread
+	explicit AssetsManager(size_t loadercount = 2);
 
 	void createStaticSkybox6(std::array<std::string, 6> paths, const std::string& ref);
 	void createStaticSprite(const std::string& path, const std::string& ref);
+
+	/*
+	 * Decode on the loader threads and return immediately. The six skybox
+	 * faces are decoded in parallel. The asset is registered under ref when
+	 * processLoadQueue() picks it up.
+	 */
+	AssetHandle loadStaticSkybox6Async(std::array<std::string, 6> paths, const std::string& ref);
+	AssetHandle loadStaticSpriteAsync(const std::string& path, const std::string& ref);
+
+	/*
+	 * Registers the assets that finished decoding, uploads sprite textures
+	 * and runs the handle callbacks. Call it once per frame from the main
+	 * thread.
+	 */
+	void processLoadQueue();
+
+	// number of async loads not yet picked up by processLoadQueue()
+	size_t getPendingLoadCount() const { return pendingloads.size(); }
+
+	// null for unknown refs and assets that failed to load
 	std::shared_ptr<AssetBase> getAsset(const std::string& ref);
 
+	void setMemoryBudget(size_t bytes);
+	size_t getMemoryBudget() const { return memorybudget; }
+
+	// Evicts unused assets until the cache fits into the memory budget
+	void evictUnused();
+
+	const AssetCacheStats& getCacheStats() const { return stats; }
+
+	/*
+	 * Small 8 bit sprites are packed into the atlas pages when they are
+	 * loaded. Disabling it only affects sprites loaded afterwards.
+	 */
+	void setAtlasEnabled(bool isenabled) { isatlasenabled = isenabled; }
+	bool isAtlasEnabled() const { return isatlasenabled; }
+	const TextureAtlas& getAtlas() const { return atlas; }
+
 private:
-	std::unordered_map<std::string, std::shared_ptr<AssetBase>> assets;
+	struct CacheEntry {
+		uint64_t contentkey;
+		AssetType type;
+		// normalized source paths, kept to decode the asset again after eviction
+		std::vector<std::string> paths;
+		// null while evicted
+		std::shared_ptr<AssetBase> asset;
+		size_t bytes = 0;
+		uint64_t lastused = 0;
+	};
+
+	struct PendingLoad {
+		std::shared_ptr<AssetHandle::State> state;
+		std::vector<std::string> refs;
+	};
+
+	struct CompletedLoad {
+		std::string pathkey;
+		AssetType type;
+		std::vector<std::string> paths;
+		uint64_t contentkey = 0;
+		std::shared_ptr<AssetBase> asset;
+		// paths that failed to decode, logged on the main thread
+		std::vector<std::string> failedpaths;
+	};
+
+	// Outlives the manager while loader threads still hold it
+	struct LoadQueue {
+		std::mutex mutex;
+		std::vector<CompletedLoad> completed;
+
+		void push(CompletedLoad load);
+	};
+
+	// Decodes synchronously unless the content is cached, null on failure. Callers
+	// evict once they hold on to the asset.
+	CacheEntry* loadCached(AssetType type, const std::vector<std::string>& paths);
+	CacheEntry& insertEntry(uint64_t contentkey, AssetType type, std::vector<std::string> paths, std::shared_ptr<AssetBase> asset);
+	void touch(CacheEntry& entry);
+	// Brings the atlas share of residentbytes up to date after packing or releasing pages
+	void updateAtlasBytes();
+	AssetHandle loadAsync(AssetType type, const std::vector<std::string>& paths, const std::string& ref);
+
+	// content key -> entry
+	std::unordered_map<uint64_t, CacheEntry> cache;
+	// normalized path key -> content key
+	std::unordered_map<std::string, uint64_t> pathindex;
+	// caller chosen ref -> content key, refs don't keep assets alive
+	std::unordered_map<std::string, uint64_t> refs;
+	// path key -> load still running on the loader threads
+	std::unordered_map<std::string, PendingLoad> pendingloads;
+	std::shared_ptr<LoadQueue> loadqueue;
+	TextureAtlas atlas;
+	size_t atlasbytes = 0;
+	bool isatlasenabled = true;
+	AssetCacheStats stats;
+	size_t memorybudget = 512 * 1024 * 1024;
+	uint64_t accesstick = 0;
+	// Declared last so its threads are joined before anything else goes away
+	std::unique_ptr<ThreadPool> loader;
 };
 
 
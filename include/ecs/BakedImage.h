@@ -0,0 +1,72 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_BAKEDIMAGE_H
+#define GECS_BAKEDIMAGE_H
+
+#include "ecs/AssetsManager.h"
+#include "ecs/MappedFile.h"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace gecs {
+
+struct BakedMip {
+	// from the start of the file, aligned to BakedImage::alignment
+	uint64_t offset;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct BakedImageHeader {
+	static constexpr uint32_t maxmips = 16;
+
+	uint32_t magic;
+	uint32_t version;
+	// hash of the source file, so baked and source images share a cache entry
+	uint64_t sourcehash;
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t ishdr;
+	uint32_t mipcount;
+	uint32_t reserved;
+	BakedMip mips[maxmips];
+};
+static_assert(std::is_trivially_copyable_v<BakedImageHeader>);
+
+/*
+ * Raw pixels with a small header, loaded by mapping the file instead of
+ * decoding it. Files are written in the byte order of the machine baking
+ * them. AssetsManager loads baked files through the same calls as source
+ * images, any path whose contents start with the magic is treated as baked.
+ */
+class BakedImage {
+public:
+	static constexpr uint32_t magic = 0x58455447; // "GTEX"
+	static constexpr uint32_t version = 1;
+	static constexpr size_t alignment = 64;
+
+	/*
+	 * Decodes sourcepath and writes it to bakedpath, both relative to the
+	 * assets directory. desiredchannels 0 keeps the channels of the source.
+	 */
+	static bool bake(const std::string& sourcepath, const std::string& bakedpath, int desiredchannels = 0, bool generatemips = false);
+
+	// null if the file is not a valid baked image
+	static const BakedImageHeader* getHeader(const MappedFile& file);
+
+	/*
+	 * Points data at the first level of the mapped pixels without copying.
+	 * Fails if desiredchannels is not 0 and differs from the baked channels.
+	 */
+	static bool load(std::shared_ptr<MappedFile> file, int desiredchannels, ImageData& data);
+
+	static uint64_t hashSource(const unsigned char* bytes, size_t size);
+};
+
+}
+
+#endif//GECS_BAKEDIMAGE_H
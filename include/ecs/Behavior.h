@@ -29,6 +29,13 @@ protected:
 };
 
 struct BehaviorsComponent : public ComponentBase {
+	BehaviorsComponent() = default;
+	// Behaviors hold per-entity state, copies get their own clone of each behavior
+	BehaviorsComponent(const BehaviorsComponent& other);
+	BehaviorsComponent& operator=(const BehaviorsComponent& other);
+	BehaviorsComponent(BehaviorsComponent&&) = default;
+	BehaviorsComponent& operator=(BehaviorsComponent&&) = default;
+
 	void onUpdate(Entity entity, float deltatime);
 	void onEvent(gEvent& event);
 	bool onKeyPressed(gKeyPressedEvent& event);
@@ -38,12 +45,18 @@ struct BehaviorsComponent : public ComponentBase {
 	template<typename T, typename... Args>
 	T& addBehavior(Args&&... args) {
 		behaviors[typeid(T)] = std::move(std::make_shared<T>(std::forward<Args>(args)...));
+		if constexpr (std::is_copy_constructible_v<T>) {
+			cloners[typeid(T)] = [](const BehaviorBase& behavior) -> std::shared_ptr<BehaviorBase> {
+				return std::make_shared<T>(static_cast<const T&>(behavior));
+			};
+		}
 		return *getBehavior<T>();
 	}
 
 	template<typename T>
 	void removeBehavior() {
 		behaviors.erase(typeid(T));
+		cloners.erase(typeid(T));
 	}
 
 	template<typename T>
@@ -62,7 +75,10 @@ struct BehaviorsComponent : public ComponentBase {
 	}
 
 private:
+	using Cloner = std::shared_ptr<BehaviorBase> (*)(const BehaviorBase&);
+
 	std::unordered_map<std::type_index, std::shared_ptr<BehaviorBase>> behaviors;
+	std::unordered_map<std::type_index, Cloner> cloners;
 	bool firstupdate = true;
 };
 
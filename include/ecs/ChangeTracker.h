@@ -0,0 +1,57 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_CHANGETRACKER_H
+#define GECS_CHANGETRACKER_H
+
+#include "entt/entt.hpp"
+
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Entities whose component changed since the last collect(). Each thread of
+ * the shared pool appends to its own list, so marking never locks. Callers
+ * mark an entity once until it is collected.
+ */
+class ChangeTracker {
+public:
+	ChangeTracker();
+
+	void mark(entt::entity handle);
+
+	// Moves every marked entity into changed, which is cleared first
+	void collect(std::vector<entt::entity>& changed);
+
+private:
+	std::vector<std::vector<entt::entity>> lists;
+};
+
+/*
+ * Tracker and entity a component reports its changes to. Copies start out
+ * detached, so a copy of a live component never reports for the original.
+ * Assigning a copy keeps the link of the target, moves hand it over.
+ */
+struct ChangeLink {
+	ChangeLink() = default;
+	ChangeLink(ChangeTracker* tracker, entt::entity owner) : tracker(tracker), owner(owner) {}
+	ChangeLink(const ChangeLink&) {}
+	ChangeLink(ChangeLink&&) = default;
+	ChangeLink& operator=(const ChangeLink&) { return *this; }
+	ChangeLink& operator=(ChangeLink&&) = default;
+
+	void mark() const {
+		if (tracker) {
+			tracker->mark(owner);
+		}
+	}
+
+	ChangeTracker* tracker = nullptr;
+	entt::entity owner = entt::null;
+};
+
+}
+
+#endif//GECS_CHANGETRACKER_H
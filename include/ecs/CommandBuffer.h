@@ -0,0 +1,123 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_COMMANDBUFFER_H
+#define GECS_COMMANDBUFFER_H
+
+#include "entt/entt.hpp"
+#include "gUUID.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace gecs {
+
+class Scene;
+
+/*
+ * Records structural changes so they can be made while systems iterate.
+ * Every thread of the pool owns one buffer, see Scene::getCommandBuffer().
+ *
+ * Commands are replayed by Scene::flushCommandBuffers() in this order:
+ * entity setup, component additions grouped by type, component removals
+ * grouped by type, then entity removals. An addition for a component the
+ * entity already has replaces it, so values recorded for a new entity's
+ * id, transform or tag win over the defaults.
+ */
+class CommandBuffer {
+public:
+	explicit CommandBuffer(Scene* scene) : scene(scene) {}
+
+	/*
+	 * The handle is valid right away so components can be added to it, but
+	 * the entity only gets its id, transform and tag when the buffer is
+	 * flushed. Handles come from a reserve the scene fills before each
+	 * phase, see Scene::setDeferredEntityReserve(). Once it runs out
+	 * entt::null is returned, commands recorded for it are dropped.
+	 */
+	entt::entity createEntity(const std::string& name = std::string());
+	entt::entity createEntityWithUUID(gUUID uuid, const std::string& name = std::string());
+	void removeEntity(entt::entity handle);
+
+	/*
+	 * Returns the pending component, it is moved into the scene on flush.
+	 */
+	template<typename T, typename... Args>
+	T& addComponent(entt::entity handle, Args&&... args) {
+		return getPool<T>().adds.emplace_back(std::piecewise_construct,
+						std::forward_as_tuple(handle), std::forward_as_tuple(std::forward<Args>(args)...)).second;
+	}
+
+	template<typename T>
+	void removeComponent(entt::entity handle) {
+		getPool<T>().removes.push_back(handle);
+	}
+
+	bool isEmpty() const { return isempty; }
+
+private:
+	friend class Scene;
+
+	struct PoolBase {
+		virtual ~PoolBase() = default;
+		virtual size_t getAddCount() const = 0;
+		virtual void reserve(Scene& scene, size_t count) = 0;
+		virtual void replayAdds(Scene& scene) = 0;
+		virtual void replayRemoves(Scene& scene) = 0;
+		virtual void clear() = 0;
+	};
+
+	template<typename T>
+	struct Pool : PoolBase {
+		// deque keeps references returned by addComponent valid
+		std::deque<std::pair<entt::entity, T>> adds;
+		std::vector<entt::entity> removes;
+
+		size_t getAddCount() const override { return adds.size(); }
+		void reserve(Scene& scene, size_t count) override;
+		void replayAdds(Scene& scene) override;
+		void replayRemoves(Scene& scene) override;
+		void clear() override {
+			adds.clear();
+			removes.clear();
+		}
+	};
+
+	struct CreateCommand {
+		entt::entity handle;
+		gUUID uuid;
+		std::string name;
+	};
+
+	template<typename T>
+	Pool<T>& getPool() {
+		isempty = false;
+		std::unique_ptr<PoolBase>& pool = pools[typeid(T)];
+		if (!pool) {
+			pool = std::make_unique<Pool<T>>();
+		}
+		return static_cast<Pool<T>&>(*pool);
+	}
+
+	void clear();
+
+	Scene* scene;
+	// Created by the scene on the main thread, so workers never create in the registry
+	std::vector<entt::entity> reservedhandles;
+	// handles asked for since the last refill, the next refill makes room for twice as many
+	size_t requestedhandles = 0;
+	bool isreserveempty = false;
+	std::vector<CreateCommand> creates;
+	std::vector<entt::entity> removedentities;
+	std::unordered_map<std::type_index, std::unique_ptr<PoolBase>> pools;
+	bool isempty = true;
+};
+
+}
+
+#endif//GECS_COMMANDBUFFER_H
@@ -6,6 +6,7 @@
 #define GIPECS_GCOMPONENTS_H
 
 #include "AssetsManager.h"
+#include "ecs/ChangeTracker.h"
 #include "entt/entt.hpp"
 #include "gCamera.h"
 #include "gEvent.h"
@@ -16,14 +17,17 @@
 #include "gUUID.h"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <limits>
 #include <string>
 #include <typeindex>
 
 namespace gecs {
 
-struct ComponentBase {
-	virtual ~ComponentBase() = default;
-};
+class TagIndex;
+
+// Empty tag, components are stored by value and never deleted through it
+struct ComponentBase {};
 
 struct IdComponent : public ComponentBase {
 	IdComponent(gUUID id) : id(id) {}
@@ -39,27 +43,63 @@ struct TreeComponent : public ComponentBase {
 	TreeComponent(const TreeComponent&) = default;
 
 	entt::entity parent = entt::null;
+	// Removed children are left as entt::null until they are compacted away
 	std::vector<entt::entity> childs;
+
+private:
+	friend class Scene;
+
+	// position of this entity in the parent's childs
+	uint32_t slot = 0;
+	uint32_t holes = 0;
 };
 
 struct TagComponent : public ComponentBase {
 	TagComponent(const std::string& tag) : tag(tag) {}
 	TagComponent() = default;
-	TagComponent(const TagComponent&) = default;
+	// Copies only take the tag, they are in no tag index until added to an entity
+	TagComponent(const TagComponent& other) : tag(other.tag) {}
+	TagComponent(TagComponent&&) = default;
+	// Goes through setTag, so this stays indexed under its own entity
+	TagComponent& operator=(const TagComponent& other) {
+		setTag(other.tag);
+		return *this;
+	}
+	TagComponent& operator=(TagComponent&&) = default;
+
+	const std::string& getTag() const { return tag; }
+	// Renames keep the scene's tag index up to date.
+	void setTag(const std::string& newtag);
+
+private:
+	friend class TagIndex;
 
 	std::string tag;
+	TagIndex* index = nullptr;
+	entt::entity owner = entt::null;
+	uint32_t tagid = std::numeric_limits<uint32_t>::max();
+	uint32_t slot = 0;
 };
 
 struct TransformComponent : public ComponentBase {
+	// Removing a transform leaves a hole instead of moving the last one
+	// into its place, so a live component is never assigned by the storage
+	static constexpr auto in_place_delete = true;
+
 	TransformComponent() = default;
+	// Copies and moves start out detached from the source's entity
 	TransformComponent(const TransformComponent&) = default;
-
-	glm::vec3 getForward();
-	glm::vec3 getBackward();
-	glm::vec3 getLeft();
-	glm::vec3 getRight();
-	glm::vec3 getUp();
-	glm::vec3 getDown();
+	// Only the local transform is taken over, this stays linked to its own entity
+	TransformComponent& operator=(const TransformComponent& other);
+	TransformComponent& operator=(TransformComponent&& other) { return *this = static_cast<const TransformComponent&>(other); }
+
+	// Unit axes of the orientation, in the space of the parent
+	glm::vec3 getForward() const;
+	glm::vec3 getBackward() const;
+	glm::vec3 getLeft() const;
+	glm::vec3 getRight() const;
+	glm::vec3 getUp() const;
+	glm::vec3 getDown() const;
 
 	void move(float dx, float dy, float dz);
 
@@ -69,14 +109,25 @@ struct TransformComponent : public ComponentBase {
 
 	void setPosition(const glm::vec3& pos) { setPosition(pos.x, pos.y, pos.z); }
 
+	// Euler angles in degrees, applied on top of the current orientation
 	void rotate(float dx, float dy, float dz);
 
 	void rotate(const glm::vec3& delta) { rotate(delta.x, delta.y, delta.z); }
 
+	void rotate(const glm::quat& delta);
+
+	// Euler angles in degrees
 	void setRotation(float x, float y, float z);
 
 	void setRotation(const glm::vec3& rot) { setRotation(rot.x, rot.y, rot.z); }
 
+	// Euler angles in degrees, converted from the orientation on every call
+	glm::vec3 getRotation() const { return glm::degrees(glm::eulerAngles(rotation)); }
+
+	void setOrientation(const glm::quat& orientation);
+
+	const glm::quat& getOrientation() const { return rotation; }
+
 	void resize(float dx, float dy, float dz);
 
 	void resize(const glm::vec3& delta) { resize(delta.x, delta.y, delta.z); }
@@ -92,23 +143,54 @@ struct TransformComponent : public ComponentBase {
 		float len2 = glm::dot(to, to);
 		if (len2 < 1e-12f) return; // same point
 
-		glm::quat lookorientation = glm::conjugate(glm::quat_cast(glm::lookAt(position, glm::vec3(x, y, z), glm::vec3(0.0f, 1.0f, 0.0f))));
-		rotation = glm::degrees(glm::eulerAngles(lookorientation));
-		ischanged = true;
+		rotation = glm::conjugate(glm::quat_cast(glm::lookAt(position, glm::vec3(x, y, z), glm::vec3(0.0f, 1.0f, 0.0f))));
+		markChanged();
 	}
 
 private:
 	friend class Scene;
 
+	// Reports the entity to its scene the first time it changes in a frame
+	void markChanged() {
+		if (!ischanged) {
+			ischanged = true;
+			link.mark();
+		}
+	}
+
 	glm::vec3 position = {0.0f, 0.0f, 0.0f};
-	// rotation is in degrees
-	glm::vec3 rotation = {0.0f, 0.0f, 0.0f};
+	glm::quat rotation = {1.0f, 0.0f, 0.0f, 0.0f};
 	glm::vec3 scale = {1.0f, 1.0f, 1.0f};
 	glm::vec3 pivot = {0.0f, 0.0f, 0.0f};
 
 	bool ischanged = true;
-	glm::mat4 transformmatrix = {};
-	glm::mat3 normalmatrix = {};
+	// set by the transform pass when the world matrix was recomputed this frame
+	bool isworldchanged = false;
+	ChangeLink link;
+};
+
+/*
+ * Added next to every TransformComponent and kept up to date by the scene's
+ * transform pass. Stored apart so systems moving entities around don't pull
+ * matrices through the cache.
+ */
+struct WorldMatrixComponent : public ComponentBase {
+	const glm::mat4& getMatrix() const { return matrix; }
+
+private:
+	friend class Scene;
+
+	glm::mat4 matrix{1.0f};
+};
+
+// inverseTranspose of the world matrix, for lighting
+struct NormalMatrixComponent : public ComponentBase {
+	const glm::mat3& getMatrix() const { return matrix; }
+
+private:
+	friend class Scene;
+
+	glm::mat3 matrix{1.0f};
 };
 
 struct SpriteComponent : public ComponentBase {
@@ -116,17 +198,28 @@ struct SpriteComponent : public ComponentBase {
 	SpriteComponent(const SpriteComponent&) = default;
 
 	void setAsset(std::shared_ptr<AssetBase> asset);
+
+	// Sprites on higher layers are drawn on top
+	void setLayer(int layer) { this->layer = layer; }
+	int getLayer() const { return layer; }
 private:
 	friend class Scene;
 
-	gImage data;
+	int layer = 0;
+
+	// Keeps the asset from being evicted by AssetsManager while in use
+	std::shared_ptr<SpriteAsset> asset;
+	// Shared with every sprite using the same asset, copies are cheap
+	std::shared_ptr<gImage> data;
+	// Part of data to draw when the asset was packed into an atlas page
+	AtlasRegion region;
 };
 
 class Camera : public gCamera {
 public:
-	void setComponentsUnsafe(glm::vec3 pos, glm::vec3 rot, glm::vec3 scale, glm::mat4 matrix) {
+	void setComponentsUnsafe(glm::vec3 pos, glm::quat rot, glm::vec3 scale, glm::mat4 matrix) {
 		position = pos;
-		orientation = glm::quatLookAt(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::angleAxis(rot.x, glm::vec3(1.0f, 0.0f, 0.0f)) * glm::angleAxis(rot.z, glm::vec3(0.0f, 0.0f, 1.0f)) * glm::angleAxis(rot.y, glm::vec3(0.0f, 1.0f, 0.0f));
+		orientation = rot;
 		scalevec = scale;
 		lookposition = position;
 		lookorientation = orientation;
@@ -149,6 +242,8 @@ public:
 		frustum.topFace = Plane{ position, glm::cross(right, frontMultFar - up * halfVSide) };
 		frustum.bottomFace = Plane{ position, glm::cross(frontMultFar + up * halfVSide, right) };
 	}
+
+	const Frustum& getFrustum() const { return frustum; }
 };
 
 struct CameraComponent : public ComponentBase {
@@ -160,14 +255,37 @@ struct CameraComponent : public ComponentBase {
 	float farplane = 1000.0f;
 	float aspectratio = 1.0f;
 	bool isenabled = true;
+	/*
+	 * Only the first enabled camera that is not offscreen is drawn to the
+	 * screen, other on screen cameras are skipped. Offscreen cameras are
+	 * drawn for their texture, e.g. a mirror or a minimap.
+	 */
+	bool isoffscreen = false;
+	// Size of the render target relative to the screen
+	float resolutionscale = 1.0f;
+	// Offscreen cameras are only drawn every updateinterval frames
+	int updateinterval = 1;
+
+	gTexture& getTexture() { return fbo.getTexture(); }
+
+	// Models drawn and skipped by the last render pass of this camera
+	size_t getVisibleModelCount() const { return visiblemodelcount; }
+	size_t getCulledModelCount() const { return culledmodelcount; }
 
 private:
 	friend class Scene;
 	friend class Loader;
 
+	void allocate(int screenwidth, int screenheight);
+	void updateView(glm::vec3 position, glm::mat4 transformationmatrix);
 	void begin(glm::vec3 position, glm::mat4 transformationmatrix);
 	void end();
 
+	size_t visiblemodelcount = 0;
+	size_t culledmodelcount = 0;
+	int framessincedraw = 0;
+	int allocatedwidth = 0;
+	int allocatedheight = 0;
 	Camera data;
 	gFbo fbo;
 };
@@ -188,11 +306,34 @@ struct ModelComponent : public ComponentBase {
 	ModelComponent() = default;
 	ModelComponent(const ModelComponent&) = default;
 
+	/*
+	 * Bounding sphere in model space used for frustum culling, computed by
+	 * the Loader from the mesh vertices. A negative radius is never culled.
+	 */
+	void setBounds(glm::vec3 center, float radius) {
+		bounds = glm::vec4(center, radius);
+		markBoundsChanged();
+	}
+	glm::vec4 getBounds() const { return bounds; }
+
 private:
 	friend class Scene;
 	friend class Loader;
 
-	gModel data;
+	// Reports the entity to its scene, so the spatial index picks up the new bounds
+	void markBoundsChanged() {
+		if (!isboundschanged) {
+			isboundschanged = true;
+			link.mark();
+		}
+	}
+
+	glm::vec4 bounds = {0.0f, 0.0f, 0.0f, -1.0f};
+	bool isboundschanged = false;
+	ChangeLink link;
+
+	// Shared by every component loaded from the same path, animation state included
+	std::shared_ptr<gModel> data;
 };
 
 }
@@ -0,0 +1,66 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_DRAWLIST_H
+#define GECS_DRAWLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace gecs {
+
+enum class DrawPass {
+	// drawn first, front to back within each material and mesh
+	GEOMETRY,
+	// drawn after, back to front
+	TRANSLUCENT,
+};
+
+struct DrawCommand {
+	uint64_t key;
+	uint32_t payload;
+};
+
+/*
+ * Draw commands of one render pass, sorted by a 64 bit key before they are
+ * executed. For geometry the key orders by material, then mesh, then depth,
+ * so state changes are rare and near objects fill the depth buffer first.
+ * Translucent commands are ordered by depth, furthest first.
+ */
+class DrawList {
+public:
+	// depth is the distance to the camera divided by its far plane
+	static uint64_t makeKey(DrawPass pass, uint32_t material, uint32_t mesh, float depth);
+
+	/*
+	 * Small ids for a material or mesh to put into a key, handed out in order
+	 * of first use and reset by clear(). Ids past the width of their key field
+	 * wrap around, resources sharing an id are only grouped less well.
+	 */
+	uint32_t getMaterialId(const void* material) { return getId(materialids, material); }
+	uint32_t getMeshId(const void* mesh) { return getId(meshids, mesh); }
+
+	void add(uint64_t key, uint32_t payload) { commands.push_back({key, payload}); }
+	void clear();
+
+	// Stable radix sort, bytes all keys share are skipped
+	void sort();
+
+	const std::vector<DrawCommand>& getCommands() const { return commands; }
+	size_t size() const { return commands.size(); }
+
+private:
+	static uint32_t getId(std::unordered_map<const void*, uint32_t>& ids, const void* resource);
+
+	std::vector<DrawCommand> commands;
+	std::vector<DrawCommand> scratch;
+	std::unordered_map<const void*, uint32_t> materialids;
+	std::unordered_map<const void*, uint32_t> meshids;
+};
+
+}
+
+#endif//GECS_DRAWLIST_H
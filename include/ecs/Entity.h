@@ -11,10 +11,13 @@
 
 namespace gecs {
 
+/*
+ * A plain (handle, scene) pair, cheap to create per entity per frame.
+ * Hierarchy data is looked up when asked for.
+ */
 class Entity {
 public:
-	Entity(entt::entity handle, Scene* scene);
-	~Entity();
+	Entity(entt::entity handle, Scene* scene) : entityhandle(handle), scene(scene) {}
 
 	template<typename T, typename... Args>
 	T& addComponent(Args&&... args) {
@@ -57,11 +60,16 @@ public:
 	}
 
 	const std::string& getName() {
-		return getComponent<TagComponent>().tag;
+		return getComponent<TagComponent>().getTag();
 	}
-	Entity getParent() const { return {parenthandle, scene}; }
-	entt::entity getParentHandle() const { return parenthandle; }
-	const std::vector<entt::entity>* getChildHandles() const { return childhandles; }
+
+	void setName(const std::string& name) {
+		getComponent<TagComponent>().setTag(name);
+	}
+	Entity getParent() const { return {getParentHandle(), scene}; }
+	entt::entity getParentHandle() const;
+	// Returns nullptr if the entity is not part of a hierarchy
+	const std::vector<entt::entity>* getChildHandles() const;
 
 	bool operator==(const Entity& other) const {
 		return entityhandle == other.entityhandle && scene == other.scene;
@@ -76,8 +84,6 @@ public:
 private:
 	entt::entity entityhandle;
 	Scene* scene;
-	entt::entity parenthandle;
-	std::vector<entt::entity>* childhandles;
 };
 
 }
@@ -0,0 +1,48 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_FRUSTUMCULLER_H
+#define GECS_FRUSTUMCULLER_H
+
+#include "gCamera.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Tests world space bounding spheres against a camera frustum. Spheres are
+ * stored as separate coordinate arrays and tested one plane at a time over
+ * all of them, which the compiler turns into 4 or 8 wide SIMD loops.
+ */
+class FrustumCuller {
+public:
+	void clear();
+	void reserve(size_t count);
+
+	// An infinite radius is never culled
+	void add(const glm::vec3& center, float radius);
+
+	size_t size() const { return count; }
+
+	/*
+	 * visible[i] is set to 1 if sphere i touches the frustum, 0 otherwise.
+	 * Returns the number of visible spheres. Safe to call from several
+	 * threads at once.
+	 */
+	size_t cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+
+private:
+	size_t count = 0;
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> zs;
+	std::vector<float> radii;
+};
+
+}
+
+#endif//GECS_FRUSTUMCULLER_H
@@ -11,6 +11,11 @@ namespace gecs {
 
 class Loader {
 public:
+	/*
+	 * Components loaded from the same path share one gModel, including its
+	 * animation state and node transforms, so animating one of them animates
+	 * every copy.
+	 */
 	static void loadModelComponent(ModelComponent& model, const std::string& modelpath);
 };
 
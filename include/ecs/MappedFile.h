@@ -0,0 +1,44 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_MAPPEDFILE_H
+#define GECS_MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace gecs {
+
+/*
+ * Read only view of a whole file mapped into memory. Pages are copy on
+ * write, so writes through getData() never reach the file.
+ */
+class MappedFile {
+public:
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// null if the file can't be opened or is empty
+	static std::shared_ptr<MappedFile> open(const std::string& fullpath);
+
+	unsigned char* getData() const { return data; }
+	size_t getSize() const { return size; }
+
+private:
+	MappedFile() = default;
+
+	unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* filehandle = nullptr;
+	void* mappinghandle = nullptr;
+#endif
+};
+
+}
+
+#endif//GECS_MAPPEDFILE_H
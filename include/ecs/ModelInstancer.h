@@ -0,0 +1,80 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_MODELINSTANCER_H
+#define GECS_MODELINSTANCER_H
+
+#include "gModel.h"
+#include "gShader.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Draws many copies of one gModel with a single instanced draw call per
+ * mesh. The world matrix of every copy goes into a per-instance buffer.
+ * Meshes are copied into buffers of their own the first time a model is
+ * drawn, and dropped once the model is gone.
+ *
+ * Copies are shaded with the diffuse color and map of each mesh, lit by
+ * the given ambient light only. Models needing the engine's full lighting
+ * are drawn through gModel::draw() instead, see Scene::setModelInstancing.
+ */
+class ModelInstancer {
+public:
+	ModelInstancer() = default;
+	~ModelInstancer();
+
+	ModelInstancer(const ModelInstancer&) = delete;
+	ModelInstancer& operator=(const ModelInstancer&) = delete;
+
+	// Animated models change their vertices every frame and can't be instanced
+	static bool canInstance(gModel& model);
+
+	/*
+	 * Draws model once for every matrix with the current view and
+	 * projection of the renderer. Must be called from the main thread.
+	 */
+	void draw(const std::shared_ptr<gModel>& model, const std::vector<glm::mat4>& matrices, const glm::vec4& ambient);
+
+	// Frees the buffers of models nobody holds anymore
+	void releaseUnused();
+
+	// draw calls issued since the last releaseUnused()
+	size_t getDrawCallCount() const { return drawcalls; }
+
+private:
+	struct MeshBuffers {
+		gMesh* mesh;
+		// mesh transform relative to its model
+		glm::mat4 matrix;
+		unsigned int vao = 0;
+		unsigned int vbo = 0;
+		unsigned int ebo = 0;
+		int count = 0;
+	};
+
+	struct ModelBuffers {
+		std::weak_ptr<gModel> model;
+		std::vector<MeshBuffers> meshes;
+	};
+
+	void setup();
+	ModelBuffers& getBuffers(const std::shared_ptr<gModel>& model);
+	void createMesh(gModel& model, gMesh* mesh, MeshBuffers& buffers);
+	static void deleteBuffers(ModelBuffers& buffers);
+
+	std::unique_ptr<gShader> shader;
+	std::vector<ModelBuffers> models;
+	unsigned int instancevbo = 0;
+	size_t instancecapacity = 0;
+	size_t drawcalls = 0;
+};
+
+}
+
+#endif//GECS_MODELINSTANCER_H
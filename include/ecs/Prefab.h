@@ -0,0 +1,108 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_PREFAB_H
+#define GECS_PREFAB_H
+
+#include "ecs/Behavior.h"
+#include "ecs/Components.h"
+#include "ecs/Entity.h"
+#include "ecs/Scene.h"
+
+#include <memory>
+#include <typeindex>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * A component set with initial values, instantiated with
+ * Scene::instantiate(). Each component is copied into every instance in one
+ * bulk insert. Sprites share the texture of their asset, so nothing is
+ * loaded again.
+ */
+class Prefab {
+public:
+	Prefab() = default;
+	Prefab(Prefab&&) = default;
+	Prefab& operator=(Prefab&&) = default;
+
+	/*
+	 * Captures the name, transform, sprite, ambient light and behaviors of
+	 * the entity. Other components are added with capture<T>().
+	 */
+	static Prefab fromEntity(Entity entity);
+
+	/*
+	 * Copies the component of the entity, if it has one.
+	 */
+	template<typename T>
+	Prefab& capture(Entity entity) {
+		if (entity.hasComponent<T>()) {
+			set<T>(entity.getComponent<T>());
+		}
+		return *this;
+	}
+
+	template<typename T>
+	Prefab& set(const T& component) {
+		static_assert(!std::is_same_v<T, IdComponent> && !std::is_same_v<T, TagComponent> && !std::is_same_v<T, TransformComponent>,
+					  "Use setName() and setTransform() instead");
+		static_assert(!std::is_same_v<T, WorldMatrixComponent> && !std::is_same_v<T, NormalMatrixComponent>,
+					  "Matrices are computed from the transform");
+		static_assert(!std::is_same_v<T, TreeComponent>,
+					  "Instances are linked to each other with Scene::linkEntities()");
+		for (auto& [type, slot] : components) {
+			if (type == typeid(T)) {
+				slot = std::make_unique<Slot<T>>(component);
+				return *this;
+			}
+		}
+		components.emplace_back(typeid(T), std::make_unique<Slot<T>>(component));
+		return *this;
+	}
+
+	template<typename T>
+	bool has() const {
+		for (auto& [type, slot] : components) {
+			if (type == typeid(T)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void setName(const std::string& name) { this->name = name; }
+	const std::string& getName() const { return name; }
+
+	void setTransform(const TransformComponent& transform) { this->transform = transform; }
+	const TransformComponent& getTransform() const { return transform; }
+
+private:
+	friend class Scene;
+
+	struct SlotBase {
+		virtual ~SlotBase() = default;
+		virtual void insertInto(Scene& scene, const std::vector<entt::entity>& handles) const = 0;
+	};
+
+	template<typename T>
+	struct Slot : SlotBase {
+		explicit Slot(const T& value) : value(value) {}
+
+		void insertInto(Scene& scene, const std::vector<entt::entity>& handles) const override {
+			scene.insertComponents<T>(handles, value);
+		}
+
+		T value;
+	};
+
+	std::string name;
+	TransformComponent transform;
+	std::vector<std::pair<std::type_index, std::unique_ptr<SlotBase>>> components;
+};
+
+}
+
+#endif//GECS_PREFAB_H
@@ -5,32 +5,104 @@
 #ifndef GIPECS_GSCENE_H
 #define GIPECS_GSCENE_H
 
+#include "ecs/CommandBuffer.h"
 #include "ecs/Components.h"
+#include "ecs/DrawList.h"
+#include "ecs/FrustumCuller.h"
+#include "ecs/ModelInstancer.h"
+#include "ecs/SpatialHashGrid.h"
+#include "ecs/SpatialIndex.h"
 #include "ecs/Ref.h"
+#include "ecs/SpriteBatch.h"
 #include "ecs/System.h"
+#include "ecs/SystemScheduler.h"
+#include "ecs/TagIndex.h"
+#include "ecs/TransformKernel.h"
 #include "gBaseCanvas.h"
 #include "gUUID.h"
 
+#include <array>
+#include <functional>
+
 namespace gecs {
 enum class SystemType {
 	UPDATE,
+	// Runs after world matrices were propagated for the frame
+	LATEUPDATE,
 	DRAW3D,
-	DRAW2D
+	// Runs for each camera once the queued draws of DRAW3D are done, for debug lines and gizmos
+	LATEDRAW3D,
+	DRAW2D,
+	// Number of phases, not a phase itself. New phases go above it.
+	COUNT
 };
 
+constexpr size_t SYSTEMTYPE_COUNT = static_cast<size_t>(SystemType::COUNT);
+
 class Entity;
 class BehaviorsComponent;
+class Prefab;
 
 class Scene : gRenderObject {
 public:
 	Scene();
 	~Scene();
 
+	/*
+	 * Called from a deferring system the handle is reserved right away, but
+	 * the entity only gets its id, transform and tag on the next flush.
+	 */
 	Entity createEntity(const std::string& name = std::string());
 	Entity createEntityWithUUID(gUUID uuid,
 								 const std::string& name = std::string());
 	void removeEntity(Entity entity);
 
+	/*
+	 * Creates count entities at once, copying prototype into each of them.
+	 * Storage and the UUID map are grown once for the whole batch, and the
+	 * world matrices are computed by the next transform pass. Like
+	 * createEntity, calls made from a deferring system are recorded to the
+	 * command buffer and the entities are set up when it is flushed.
+	 */
+	std::vector<entt::entity> createEntities(size_t count, const std::string& name = std::string(),
+											 const TransformComponent& prototype = TransformComponent());
+
+	/*
+	 * Creates count copies of the prefab with the batch creation path.
+	 */
+	std::vector<entt::entity> instantiate(const Prefab& prefab, size_t count = 1);
+
+	/*
+	 * Copies value into every entity of handles with one bulk insert. None
+	 * of them may have the component yet.
+	 */
+	template<typename T>
+	void insertComponents(const std::vector<entt::entity>& handles, const T& value) {
+		if (isDeferring()) [[unlikely]] {
+			for (entt::entity handle : handles) {
+				getCommandBuffer().addComponent<T>(handle, value);
+			}
+			return;
+		}
+		registry.insert<T>(handles.begin(), handles.end(), value);
+		for (entt::entity handle : handles) {
+			onAddComponent(handle, registry.get<T>(handle));
+		}
+	}
+
+	/*
+	 * Removes every entity of the range, which holds entt::entity or Entity.
+	 */
+	template<typename It>
+	void removeEntities(It first, It last) {
+		for (; first != last; ++first) {
+			removeHandle(static_cast<entt::entity>(*first));
+		}
+		if (hierarchyholes * 2 > scenehierarchy.size()) {
+			compactHierarchy();
+		}
+	}
+
 	void onUpdate(float_t deltatime);
 	void onEvent(gEvent& event);
 
@@ -46,6 +118,16 @@ public:
 	void onAddComponent(entt::entity entity, CameraComponent& component);
 	template<>
 	void onAddComponent(entt::entity entity, TransformComponent& component);
+	template<>
+	void onRemoveComponent(entt::entity entity, TransformComponent& component);
+	template<>
+	void onAddComponent(entt::entity entity, TagComponent& component);
+	template<>
+	void onRemoveComponent(entt::entity entity, TagComponent& component);
+	template<>
+	void onAddComponent(entt::entity entity, ModelComponent& component);
+	template<>
+	void onRemoveComponent(entt::entity entity, ModelComponent& component);
 
 	template<typename T, typename... Args>
 	T& addComponent(entt::entity handle, Args&&... args) {
@@ -53,6 +135,9 @@ public:
 			//throw std::runtime_error("Entity already has component!");
 			return getComponent<T>(handle);
 		}
+		if (isDeferring()) [[unlikely]] {
+			return getCommandBuffer().addComponent<T>(handle, std::forward<Args>(args)...);
+		}
 		auto& component = registry.emplace<T>(
 				handle, std::forward<Args>(args)...);
 		onAddComponent(handle, component);
@@ -76,6 +161,10 @@ public:
 
 	template<typename T>
 	void removeComponent(entt::entity handle) {
+		if (isDeferring()) [[unlikely]] {
+			getCommandBuffer().removeComponent<T>(handle);
+			return;
+		}
 		if (!hasComponent<T>(handle)) {
 			return;
 		}
@@ -92,16 +181,57 @@ public:
 	/*
    * Returns the scene hierarchy.
    */
-	std::vector<entt::entity>& getSceneHierarchy() { return scenehierarchy; }
+	const std::vector<entt::entity>& getSceneHierarchy();
+
+	/*
+	 * Returns the children of the entity in link order, nullptr if it is
+	 * not part of a hierarchy.
+	 */
+	const std::vector<entt::entity>* getChildHandles(entt::entity handle);
 
 	void linkEntities(entt::entity parent, entt::entity child);
 	void unlinkEntities(entt::entity parent, entt::entity child);
 
 	void processDestroyQueue();
 
+	/*
+	 * Returns the command buffer of the calling thread. Threads the pool
+	 * doesn't own share the main thread's buffer.
+	 */
+	CommandBuffer& getCommandBuffer() {
+		return *commandbuffers[ThreadPool::getThreadIndex()];
+	}
+
+	/*
+	 * Replays every recorded command. Called after each update phase and
+	 * once more by SceneCanvas::update, must not run while systems iterate.
+	 */
+	void flushCommandBuffers();
+
+	/*
+	 * Handles each command buffer has ready for entities created while a
+	 * phase defers, made before the phase starts. A buffer that needed more
+	 * gets room for twice its last demand before the next phase.
+	 */
+	void setDeferredEntityReserve(size_t count) { deferredreserve = count; }
+
+	/*
+	 * Binds a system over every entity with the given components. Components
+	 * declared const are only read, which lets the scheduler run the system
+	 * next to others reading the same components. Components reached
+	 * through the entity must be declared too, or bind with an explicit
+	 * SystemAccess.
+	 */
 	template<typename Entity, typename... Components, typename Func>
 	void bindSystem(SystemType type, Func func) {
-		systems[type].push_back([this, func](float deltatime) {
+		bindSystem<Entity, Components...>(type, makeSystemAccess<Components...>(), func);
+	}
+
+	template<typename Entity, typename... Components, typename Func>
+	void bindSystem(SystemType type, SystemAccess access, Func func) {
+		// Storages are created up front so concurrent systems never create them
+		(registry.storage<std::remove_const_t<Components>>(), ...);
+		getSystems(type).add(std::move(access), [this, func](float deltatime) {
 					for (auto handle : registry.view<Components...>()) {
 						Entity entity{handle, this};
 						func(deltatime, entity, registry.get<Components>(handle)...);
@@ -109,52 +239,284 @@ public:
 				});
 	}
 
+	/*
+	 * Binds a system that only runs on entities with the given tag. Only the
+	 * entities carrying the tag are visited, the rest are never touched.
+	 */
 	template<typename Entity, typename... Components, typename Func>
 	void bindSystem(SystemType type, const std::string& tag, Func func) {
-		systems[type].push_back([this, func, tag](float deltatime) {
-					for (auto handle : registry.view<Components...>()) {
+		uint32_t tagid = tagindex.intern(tag);
+		(registry.storage<std::remove_const_t<Components>>(), ...);
+		getSystems(type).add(makeSystemAccess<const TagComponent, Components...>(), [this, func, tagid](float deltatime) {
+					const std::vector<entt::entity>& tagged = tagindex.getEntities(tagid);
+					// Iterate backwards so renames from inside the loop don't skip entities
+					for (size_t i = tagged.size(); i-- > 0;) {
+						if (i >= tagged.size()) {
+							continue;
+						}
+						entt::entity handle = tagged[i];
+						if (!registry.all_of<std::remove_const_t<Components>...>(handle)) {
+							continue;
+						}
 						Entity entity{handle, this};
-						if (entity.getName() != tag) {
+						func(deltatime, entity, registry.get<Components>(handle)...);
+					}
+				});
+	}
+
+	/*
+	 * Binds a system that only visits entities whose world transform was
+	 * computed by the latest transform pass, which runs between UPDATE and
+	 * LATEUPDATE. UPDATE systems see the changes of the previous frame. A
+	 * scene where nothing moves costs nothing.
+	 */
+	template<typename Entity, typename... Components, typename T, typename Func>
+	void bindSystem(SystemType type, Changed<T>, Func func) {
+		static_assert(std::is_same_v<T, TransformComponent>, "Only TransformComponent reports its changes");
+		(registry.storage<std::remove_const_t<Components>>(), ...);
+		getSystems(type).add(makeSystemAccess<Components...>(), [this, func](float deltatime) {
+					for (entt::entity handle : worldchanged) {
+						if (!registry.valid(handle) || !registry.all_of<std::remove_const_t<Components>...>(handle)) {
 							continue;
 						}
+						Entity entity{handle, this};
 						func(deltatime, entity, registry.get<Components>(handle)...);
 					}
 				});
 	}
 
+	/*
+	 * Binds a StaticSystem or a SystemPipeline. Member functions are called
+	 * on owner directly, without going through a std::function per entity:
+	 *
+	 * scene->bindPipeline<Entity, StaticSystem<&gApp::updateBullet, TransformComponent>>(SystemType::UPDATE, this);
+	 */
+	template<typename Entity, typename Pipeline, typename Owner>
+	void bindPipeline(SystemType type, Owner* owner) {
+		bindPipeline<Entity, Pipeline>(type, Pipeline::getAccess(), owner);
+	}
+
+	template<typename Entity, typename Pipeline, typename Owner>
+	void bindPipeline(SystemType type, SystemAccess access, Owner* owner) {
+		Pipeline::assure(registry);
+		getSystems(type).add(std::move(access), [this, owner](float deltatime) {
+					Pipeline::template run<Entity>(owner, this, registry, deltatime);
+				});
+	}
+
+	/*
+	 * Binds a system whose entities are split into chunks of grainsize and
+	 * processed on the thread pool. addComponent, removeComponent and
+	 * removeEntity calls made from the loop go to the thread's command
+	 * buffer, so the loop never sees structural changes.
+	 */
+	template<typename Entity, typename... Components, typename Func>
+	void bindParallelSystem(SystemType type, size_t grainsize, Func func) {
+		(registry.storage<std::remove_const_t<Components>>(), ...);
+		grainsize = std::max<size_t>(grainsize, 1);
+		getSystems(type).add(makeSystemAccess<Components...>(), [this, func, grainsize, handles = std::vector<entt::entity>()](float deltatime) mutable {
+					auto view = registry.view<Components...>();
+					handles.assign(view.begin(), view.end());
+					size_t chunks = (handles.size() + grainsize - 1) / grainsize;
+					ThreadPool::getShared().dispatch(chunks, [&](size_t chunk) {
+						const Scene* previous = deferringscene;
+						deferringscene = this;
+						size_t end = std::min(handles.size(), (chunk + 1) * grainsize);
+						for (size_t i = chunk * grainsize; i < end; i++) {
+							entt::entity handle = handles[i];
+							Entity entity{handle, this};
+							func(deltatime, entity, registry.get<Components>(handle)...);
+						}
+						deferringscene = previous;
+					});
+				});
+	}
+
+	/*
+	 * When enabled, non-conflicting UPDATE and LATEUPDATE systems run
+	 * concurrently on the shared thread pool, and structural changes they make
+	 * are applied once their phase ends. Draw systems always run on the
+	 * calling thread. Off by default, since systems that reach components not
+	 * declared in their access would race.
+	 */
+	void setParallelUpdate(bool isparallel) { isparallelupdate = isparallel; }
+	bool isParallelUpdate() const { return isparallelupdate; }
+
+	/*
+	 * When enabled, sprites are drawn through a SpriteBatch: a few draw calls
+	 * per frame instead of one per sprite. Otherwise every sprite is drawn
+	 * with gImage::draw.
+	 */
+	void setSpriteBatching(bool isbatching) { isspritebatching = isbatching; }
+	bool isSpriteBatching() const { return isspritebatching; }
+	const SpriteBatch& getSpriteBatch() const { return spritebatch; }
+
+	/*
+	 * When enabled, copies of the same static model seen by a camera are drawn
+	 * with one instanced draw call per mesh. Instanced copies are shaded with
+	 * their diffuse color and map under the scene's ambient light only, turn
+	 * this off for models that rely on the engine's full lighting.
+	 */
+	void setModelInstancing(bool isinstancing) { ismodelinstancing = isinstancing; }
+	bool isModelInstancing() const { return ismodelinstancing; }
+	const ModelInstancer& getModelInstancer() const { return modelinstancer; }
+
 	void update(float deltatime);
 	void draw(float deltatime);
 
 	void setSkybox(std::shared_ptr<AssetBase> asset);
 
+	/*
+	 * True while DRAW3D runs for a camera that can't see the entity's model.
+	 * Entities without a ModelComponent are never culled.
+	 */
+	bool isCulled(entt::entity handle) const;
+
+	/*
+	 * Queues a draw from a DRAW3D system. Draws of every DRAW3D system are
+	 * sorted by pass, material and mesh, then by distance to the camera, and
+	 * run once the systems returned. material and mesh only need to identify
+	 * the state the draw binds, e.g. the shader and the model.
+	 */
+	void submitDraw(DrawPass pass, const void* material, const void* mesh, const glm::vec3& position, std::function<void()> draw);
+	const DrawList& getDrawList() const { return drawlist; }
+
+	/*
+	 * Spatial queries over every entity with a transform. Models are bounded
+	 * by their bounding sphere, other entities by their position. The index
+	 * is refitted by the transform pass, so entities moved or models loaded
+	 * since the last update are found at their previous place. Each call clears results.
+	 */
+	void queryAabb(const glm::vec3& min, const glm::vec3& max, std::vector<entt::entity>& results) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<entt::entity>& results) const;
+	void queryFrustum(const Frustum& frustum, std::vector<entt::entity>& results) const;
+	// Nearest first, direction must be normalized
+	void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxdistance, std::vector<entt::entity>& results) const;
+	const SpatialIndex& getSpatialIndex() const { return spatialindex; }
+
+	/*
+	 * Grid over the rects of every sprite, in sprite space with the origin
+	 * at the bottom left. Rebuilt at the start of update(), so UPDATE
+	 * systems, parallel ones too, see the positions of the previous frame.
+	 * Rotation is ignored.
+	 */
+	const SpatialHashGrid& getSpriteGrid() const { return spritegrid; }
+	void setSpriteGridCellSize(float size) { spritegrid.setCellSize(size); }
+
 private:
 	bool onWindowResizeEvent(gWindowResizeEvent& event);
+	void trackTransform(entt::entity handle, TransformComponent& transform);
 	glm::mat4 makeLocal(const TransformComponent& transform);
-	glm::mat4 getWorldMatrix(entt::entity entity);
+	glm::mat3 makeLocalNormal(const TransformComponent& transform);
 	void updateMatrices(entt::entity entity);
-	void destroyEntity(entt::entity handle);
+	void propagateTransforms();
+	void rebuildSpriteGrid();
+	Aabb computeBounds(entt::entity handle, const glm::mat4& matrix);
+	void removeHandle(entt::entity handle);
+	void detachEntity(entt::entity handle);
+	void eraseChild(TreeComponent& parenttree, TreeComponent& childtree);
+	// Folds the parent's transform into the child's, for children that become roots
+	void applyParentTransform(entt::entity parent, entt::entity child);
+	void compactChildren(TreeComponent& tree);
+	void compactHierarchy();
+	void runSystems(SystemType type, ThreadPool* pool, float deltatime);
+	SystemScheduler& getSystems(SystemType type) { return systems[static_cast<size_t>(type)]; }
+
+	bool isDeferring() const { return isdeferringphase || deferringscene == this; }
+	void refillHandles();
+	void setupEntity(entt::entity handle, gUUID uuid, const std::string& name);
+
+	// Used when a recorded component is replayed onto an entity that already has one
+	template<typename T>
+	void replaceComponent(entt::entity handle, T& component) {
+		registry.get<T>(handle) = std::move(component);
+	}
+	template<>
+	void replaceComponent(entt::entity handle, IdComponent& component);
+	template<>
+	void replaceComponent(entt::entity handle, TagComponent& component);
+	template<>
+	void replaceComponent(entt::entity handle, ModelComponent& component);
 
-	void updateTransform(float deltatime, Entity entity, TransformComponent& transform);
-	void updateCamera(float deltatime, Entity entity, TransformComponent& transform, CameraComponent& camera);
-	void updateModel(float deltatime, Entity entity, TransformComponent& transform, ModelComponent& model);
+	void updateCamera(float deltatime, Entity entity, const TransformComponent& transform, const WorldMatrixComponent& world, CameraComponent& camera);
 	void updateLight(float deltatime, Entity entity, TransformComponent& transform, LightAmbientComponent& light);
+	void renderSprites(float deltatime);
 	void renderSprite(float deltatime, Entity entity, TransformComponent& transform, SpriteComponent& sprite);
-	void renderModel(float deltatime, Entity entity, TransformComponent& transform, ModelComponent& model);
+	void prepareModels();
+	void prepareViews();
+	void renderModels(float deltatime);
+	float getDrawDepth(const glm::vec3& position) const;
+	void executeDrawList();
+	glm::vec4 getAmbientLight();
 	void updateBehaviors(float deltatime, Entity entity, BehaviorsComponent& behaviors);
 
 private:
 	friend class SceneCanvas;
+	friend class CommandBuffer;
 
 	std::unordered_map<gUUID, entt::entity> entities;
 	entt::registry registry;
+	TagIndex tagindex{registry};
 	bool firstupdate = true;
 	std::vector<entt::entity> scenehierarchy;
+	// slot of each entity in scenehierarchy, indexed by entity id
+	std::vector<uint32_t> hierarchyslots;
+	size_t hierarchyholes = 0;
 	std::vector<entt::entity> destroyqueue;
-
-	std::unordered_map<SystemType, std::vector<std::function<void(float)>>> systems;
+	std::vector<std::pair<entt::entity, bool>> propagationstack;
+	ChangeTracker transformchanges;
+	std::vector<entt::entity> changedtransforms;
+	// models whose bounds changed, refitted by the transform pass
+	ChangeTracker modelchanges;
+	std::vector<entt::entity> changedmodels;
+	// Entities whose world matrix was computed by the last transform pass
+	std::vector<entt::entity> worldchanged;
+	TransformKernel transformkernel;
+	std::vector<entt::entity> dirtyroots;
+	std::vector<entt::entity> nestedchanges;
+	SpatialIndex spatialindex;
+	SpatialHashGrid spritegrid;
+
+	std::array<SystemScheduler, SYSTEMTYPE_COUNT> systems;
+	bool isparallelupdate = false;
+	// Set while a phase runs its systems on the pool, only written between phases
+	bool isdeferringphase = false;
+	// Scene whose parallel chunk the calling thread is running, if any
+	inline static thread_local const Scene* deferringscene = nullptr;
+	std::vector<std::unique_ptr<CommandBuffer>> commandbuffers;
+	size_t deferredreserve = 64;
 
 	gSkybox skybox;
 	bool hasskybox = false;
+	SpriteBatch spritebatch;
+	struct ModelDraw {
+		gModel* model;
+		entt::entity handle;
+	};
+	// Gathered once per frame, culled and drawn for every camera
+	std::vector<ModelDraw> modeldraws;
+	FrustumCuller modelculler;
+	// index into modeldraws of each entity, indexed by entity id
+	std::vector<uint32_t> modelslots;
+	struct RenderView {
+		entt::entity camera;
+		// modeldraws seen by the camera
+		std::vector<uint8_t> visibility;
+	};
+	// Cameras drawn this frame, the screen camera is one of them
+	std::vector<RenderView> renderviews;
+	RenderView* currentview = nullptr;
+	entt::entity screencamera = entt::null;
+	// Filled by DRAW3D systems for the current camera
+	DrawList drawlist;
+	std::vector<std::function<void()>> customdraws;
+	glm::vec3 drawposition{0.0f};
+	float drawfarplane = 1.0f;
+	bool isspritebatching = true;
+	ModelInstancer modelinstancer;
+	// world matrices of the run of copies being drawn
+	std::vector<glm::mat4> instancematrices;
+	bool ismodelinstancing = true;
 };
 
 class SceneCanvas : public gBaseCanvas {
@@ -179,6 +541,36 @@ private:
 	float deltatime;
 };
 
+template<typename T>
+void CommandBuffer::Pool<T>::reserve(Scene& scene, size_t count) {
+	auto& storage = scene.registry.storage<T>();
+	storage.reserve(storage.size() + count);
+}
+
+template<typename T>
+void CommandBuffer::Pool<T>::replayAdds(Scene& scene) {
+	for (auto& [handle, component] : adds) {
+		if (!scene.registry.valid(handle)) {
+			continue;
+		}
+		// Entities created by the buffer already have their default id, transform and tag
+		if (scene.hasComponent<T>(handle)) {
+			scene.replaceComponent(handle, component);
+		} else {
+			scene.addComponent<T>(handle, std::move(component));
+		}
+	}
+}
+
+template<typename T>
+void CommandBuffer::Pool<T>::replayRemoves(Scene& scene) {
+	for (entt::entity handle : removes) {
+		if (scene.registry.valid(handle)) {
+			scene.removeComponent<T>(handle);
+		}
+	}
+}
+
 }
 
 
@@ -0,0 +1,74 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_SPATIALHASHGRID_H
+#define GECS_SPATIALHASHGRID_H
+
+#include "entt/entt.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Uniform grid over 2D rects, rebuilt from scratch every frame. Cells are
+ * hashed into a table sized to the entry count and stored flat: the entries
+ * of a bucket are contiguous in one array. Queries only read, so any number
+ * of threads may query while nobody rebuilds.
+ */
+class SpatialHashGrid {
+public:
+	explicit SpatialHashGrid(float cellsize = 64.0f) { setCellSize(cellsize); }
+
+	// Must be positive, other sizes are rejected and the current one is kept
+	void setCellSize(float size);
+	float getCellSize() const { return cellsize; }
+
+	// Rects added after clear() are queryable once build() ran
+	void clear();
+	void add(entt::entity handle, const glm::vec2& min, const glm::vec2& max);
+	void build();
+
+	size_t size() const { return entries.size(); }
+
+	// Each query clears results before filling it, an entity is reported once
+	void queryRect(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& results) const;
+	void queryRadius(const glm::vec2& center, float radius, std::vector<entt::entity>& results) const;
+	// Entities whose rect overlaps the rect of handle, without handle itself
+	void queryOverlaps(entt::entity handle, std::vector<entt::entity>& results) const;
+
+private:
+	struct Entry {
+		entt::entity handle;
+		glm::vec2 min;
+		glm::vec2 max;
+	};
+
+	// Cells of one bucket may collide, so each record keeps the cell it was added for
+	struct CellEntry {
+		uint32_t entry;
+		glm::ivec2 cell;
+	};
+
+	glm::ivec2 getCell(const glm::vec2& position) const;
+	uint32_t getBucket(int x, int y) const;
+
+	template<typename Accept>
+	void query(const glm::vec2& min, const glm::vec2& max, Accept accept, std::vector<entt::entity>& results) const;
+
+	float cellsize = 64.0f;
+	std::vector<Entry> entries;
+	// entry index of each entity, indexed by entity id
+	std::vector<uint32_t> slots;
+	// bucket b holds cellentries[bucketstarts[b], bucketstarts[b + 1])
+	std::vector<uint32_t> bucketstarts;
+	std::vector<CellEntry> cellentries;
+	uint32_t bucketmask = 0;
+};
+
+}
+
+#endif//GECS_SPATIALHASHGRID_H
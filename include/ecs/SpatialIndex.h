@@ -0,0 +1,101 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_SPATIALINDEX_H
+#define GECS_SPATIALINDEX_H
+
+#include "entt/entt.hpp"
+#include "gCamera.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace gecs {
+
+struct Aabb {
+	glm::vec3 min;
+	glm::vec3 max;
+
+	static Aabb merge(const Aabb& a, const Aabb& b) {
+		return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+	}
+
+	bool contains(const Aabb& other) const {
+		return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+	}
+
+	bool overlaps(const Aabb& other) const {
+		return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+	}
+
+	// Surface area, the cost the tree minimizes when inserting
+	float getArea() const {
+		glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+};
+
+/*
+ * Dynamic bounding volume hierarchy over entity bounds. Every entity is a
+ * leaf holding an enlarged box, so small moves don't touch the tree. When a
+ * box leaves its enlarged box the leaf is reinserted and the tree is
+ * rebalanced with rotations on the way up. Leaves are tested against their
+ * exact box, so queries only return entities whose bounds match. Queries
+ * only read, so any number of threads may query while nobody updates.
+ */
+class SpatialIndex {
+public:
+	// Returns true if the tree changed
+	bool update(entt::entity handle, const Aabb& bounds);
+	void remove(entt::entity handle);
+	void clear();
+
+	size_t size() const { return leafcount; }
+	int getHeight() const;
+
+	// Each query clears results before filling it
+	void queryAabb(const Aabb& bounds, std::vector<entt::entity>& results) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<entt::entity>& results) const;
+	void queryFrustum(const Frustum& frustum, std::vector<entt::entity>& results) const;
+	// Entities whose box the ray hits within maxdistance, nearest first. direction must be normalized.
+	void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxdistance, std::vector<entt::entity>& results) const;
+
+private:
+	static constexpr int NODE_NONE = -1;
+
+	struct Node {
+		Aabb bounds;
+		// exact box of a leaf, bounds holds the enlarged one
+		Aabb box;
+		// next free node while on the free list
+		int parent = NODE_NONE;
+		int left = NODE_NONE;
+		int right = NODE_NONE;
+		int height = 0;
+		entt::entity handle = entt::null;
+
+		bool isLeaf() const { return left == NODE_NONE; }
+	};
+
+	template<typename Overlaps>
+	void query(Overlaps overlaps, std::vector<entt::entity>& results) const;
+
+	int allocateNode();
+	void freeNode(int index);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	void refit(int index);
+	int balance(int index);
+
+	std::vector<Node> nodes;
+	int root = NODE_NONE;
+	int freelist = NODE_NONE;
+	size_t leafcount = 0;
+	// leaf node of each entity, indexed by entity id
+	std::vector<int> leaves;
+};
+
+}
+
+#endif//GECS_SPATIALINDEX_H
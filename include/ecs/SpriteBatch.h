@@ -0,0 +1,88 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_SPRITEBATCH_H
+#define GECS_SPRITEBATCH_H
+
+#include "gImage.h"
+#include "gShader.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Collects sprite quads for a frame and draws them with one dynamic vertex
+ * buffer, one draw call per run of consecutive sprites sharing a texture.
+ * Sprites are ordered by layer and keep the order they were added in within
+ * a layer. Coordinates are in pixels with the origin at the top left, like
+ * gImage::draw.
+ */
+class SpriteBatch {
+public:
+	SpriteBatch() = default;
+	~SpriteBatch();
+
+	SpriteBatch(const SpriteBatch&) = delete;
+	SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+	// Sprites fully outside the viewport are dropped in add()
+	void begin(float viewportwidth, float viewportheight);
+
+	/*
+	 * Same placement as gImage::draw(x, y, width, height, pivotx, pivoty,
+	 * rotation), rotation in degrees. The uv rect is left, top, right, bottom.
+	 */
+	void add(gImage* texture, float x, float y, float width, float height, float pivotx, float pivoty, float rotation,
+			 const glm::vec4& uv, int layer);
+
+	/*
+	 * Draws everything added since begin(), tinted with the renderer color.
+	 * The shader, blending and buffer bindings are restored afterwards.
+	 * Must be called from the main thread.
+	 */
+	void flush();
+
+	size_t getSpriteCount() const { return textures.size(); }
+	// draw calls issued by the last flush()
+	size_t getDrawCallCount() const { return drawcalls; }
+
+private:
+	struct Vertex {
+		float x;
+		float y;
+		float u;
+		float v;
+	};
+
+	void setup();
+	void buildVertices();
+
+	float viewportwidth = 0.0f;
+	float viewportheight = 0.0f;
+
+	// Sprites are kept as parallel arrays so buildVertices() runs over plain floats
+	std::vector<float> xs, ys, widths, heights, pivotxs, pivotys, rotations;
+	std::vector<glm::vec4> uvs;
+	std::vector<gImage*> textures;
+	std::vector<int> layers;
+
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> slots;
+	std::vector<Vertex> vertices;
+
+	std::unique_ptr<gShader> shader;
+	unsigned int vao = 0;
+	unsigned int vbo = 0;
+	unsigned int ebo = 0;
+	size_t vbocapacity = 0;
+	size_t ebocapacity = 0;
+	size_t drawcalls = 0;
+};
+
+}
+
+#endif//GECS_SPRITEBATCH_H
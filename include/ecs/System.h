@@ -5,12 +5,96 @@
 #ifndef GIPECS_GSYSTEM_H
 #define GIPECS_GSYSTEM_H
 
+#include <algorithm>
 #include <functional>
 #include <type_traits>
+#include <typeindex>
+#include <vector>
 #include "entt/entt.hpp"
 
 namespace gecs {
 
+/**
+ * @brief Component types a system reads and writes
+ *
+ * Used by the scheduler to decide which systems may run at the same time.
+ * An exclusive system conflicts with every other system.
+ */
+struct SystemAccess {
+	std::vector<std::type_index> reads;
+	std::vector<std::type_index> writes;
+	bool isexclusive = false;
+
+	static SystemAccess exclusive() {
+		SystemAccess access;
+		access.isexclusive = true;
+		return access;
+	}
+
+	template<typename T>
+	SystemAccess& read() {
+		reads.emplace_back(typeid(T));
+		return *this;
+	}
+
+	template<typename T>
+	SystemAccess& write() {
+		writes.emplace_back(typeid(T));
+		return *this;
+	}
+
+	SystemAccess& merge(const SystemAccess& other) {
+		reads.insert(reads.end(), other.reads.begin(), other.reads.end());
+		writes.insert(writes.end(), other.writes.begin(), other.writes.end());
+		isexclusive = isexclusive || other.isexclusive;
+		return *this;
+	}
+
+	bool conflictsWith(const SystemAccess& other) const {
+		if (isexclusive || other.isexclusive) {
+			return true;
+		}
+		for (const std::type_index& type : writes) {
+			if (other.writes.end() != std::find(other.writes.begin(), other.writes.end(), type) ||
+				other.reads.end() != std::find(other.reads.begin(), other.reads.end(), type)) {
+				return true;
+			}
+		}
+		for (const std::type_index& type : reads) {
+			if (other.writes.end() != std::find(other.writes.begin(), other.writes.end(), type)) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/**
+ * @brief Builds the access of a system from its component list
+ *
+ * Components declared as const are read, everything else is written.
+ */
+template<typename... Components>
+SystemAccess makeSystemAccess() {
+	SystemAccess access;
+	([&access]() {
+		if constexpr (std::is_const_v<Components>) {
+			access.read<std::remove_const_t<Components>>();
+		} else {
+			access.write<Components>();
+		}
+	}(), ...);
+	return access;
+}
+
+/**
+ * @brief Filter for Scene::bindSystem, visits only entities whose T changed
+ *
+ * Usage: scene->bindSystem<Entity, const TransformComponent>(SystemType::LATEUPDATE, Changed<TransformComponent>{}, func);
+ */
+template<typename T>
+struct Changed {};
+
 /**
  * @brief Type trait to detect component references
  *
@@ -23,11 +107,65 @@ struct is_component : std::false_type {};
 template<typename T>
 struct is_component<T&> : std::true_type {};
 
+/**
+ * @brief System whose callable and components are known at compile time
+ *
+ * Method is a member function taking (float, Entity, Components&...). It is
+ * a template argument, so the per-entity call is direct and can be inlined.
+ *
+ * Usage: StaticSystem<&gApp::updateBullet, TransformComponent>
+ */
+template<auto Method, typename... Components>
+struct StaticSystem {
+	static SystemAccess getAccess() {
+		return makeSystemAccess<Components...>();
+	}
+
+	static void assure(entt::registry& registry) {
+		(registry.storage<std::remove_const_t<Components>>(), ...);
+	}
+
+	template<typename Entity, typename Owner, typename Scene>
+	static void run(Owner* owner, Scene* scene, entt::registry& registry, float deltatime) {
+		for (auto handle : registry.view<Components...>()) {
+			(owner->*Method)(deltatime, Entity{handle, scene}, registry.get<Components>(handle)...);
+		}
+	}
+};
+
+/**
+ * @brief Static systems that always run back to back, in order
+ *
+ * The whole pipeline is scheduled as one system with the combined access.
+ *
+ * Usage: SystemPipeline<StaticSystem<&gApp::moveA, A>, StaticSystem<&gApp::moveB, B>>
+ */
+template<typename... Systems>
+struct SystemPipeline {
+	static SystemAccess getAccess() {
+		SystemAccess access;
+		(access.merge(Systems::getAccess()), ...);
+		return access;
+	}
+
+	static void assure(entt::registry& registry) {
+		(Systems::assure(registry), ...);
+	}
+
+	template<typename Entity, typename Owner, typename Scene>
+	static void run(Owner* owner, Scene* scene, entt::registry& registry, float deltatime) {
+		(Systems::template run<Entity>(owner, scene, registry, deltatime), ...);
+	}
+};
+
 /**
  * @brief Alternative system function wrapper using std::function
  *
  * This version uses type erasure to handle generic lambdas from G_BIND_FUNCTION.
- * It's slightly less efficient but more flexible.
+ * It's slightly less efficient but more flexible. New code should use
+ * StaticSystem with Scene::bindPipeline, or Scene::bindSystem. Only
+ * makeSystemFunction is marked deprecated, so including this header
+ * doesn't warn.
  */
 template<typename Entity, typename Scene, typename... Components>
 class TypedSystemFunction {
@@ -70,9 +208,11 @@ public:
  * @brief Helper to create TypedSystemFunction with deduced component types
  *
  * Usage: makeSystemFunction<gTransformComponent>(G_BIND_FUNCTION(updateBullets))
+ *
+ * @deprecated Use StaticSystem with Scene::bindPipeline, or Scene::bindSystem.
  */
 template<typename... Components, typename Func>
-auto makeSystemFunction(Func&& f) {
+[[deprecated("use StaticSystem with Scene::bindPipeline")]] auto makeSystemFunction(Func&& f) {
     return TypedSystemFunction<Components...>(std::forward<Func>(f));
 }
 
@@ -83,6 +223,8 @@ auto makeSystemFunction(Func&& f) {
  * Creates a lambda that captures 'this' and creates a typed system function.
  *
  * Usage: G_BIND_TYPED_FUNCTION(memberFunctionName, ComponentA, ComponentB)
+ *
+ * @deprecated Expands to makeSystemFunction, see there.
  */
 #define G_BIND_TYPED_FUNCTION(fn, ...) \
     makeSystemFunction<__VA_ARGS__>([this](float dt, gEntity e, __VA_ARGS__& ... args) { \
@@ -0,0 +1,47 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_SYSTEMSCHEDULER_H
+#define GECS_SYSTEMSCHEDULER_H
+
+#include "ecs/System.h"
+#include "ecs/ThreadPool.h"
+
+#include <functional>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Runs the systems of one phase. With a pool, systems are ordered into
+ * waves: a system goes into the wave after the last earlier system it
+ * conflicts with, so systems of the same wave never touch the same
+ * component for writing and can run at the same time. Conflicting systems
+ * keep their binding order.
+ */
+class SystemScheduler {
+public:
+	void add(SystemAccess access, std::function<void(float)> func);
+
+	// Runs serially in binding order when pool is null, waves are only used with a pool
+	void run(float deltatime, ThreadPool* pool);
+
+	size_t getWaveCount();
+
+private:
+	struct Entry {
+		SystemAccess access;
+		std::function<void(float)> func;
+	};
+
+	void buildWaves();
+
+	std::vector<Entry> systems;
+	std::vector<std::vector<size_t>> waves;
+	bool isdirty = false;
+};
+
+}
+
+#endif//GECS_SYSTEMSCHEDULER_H
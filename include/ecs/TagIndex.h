@@ -0,0 +1,50 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_TAGINDEX_H
+#define GECS_TAGINDEX_H
+
+#include "entt/entt.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gecs {
+
+struct TagComponent;
+
+/*
+ * Interns tag strings to integer ids and keeps a dense list of entities per
+ * tag, so tagged systems only visit the entities carrying that tag.
+ */
+class TagIndex {
+public:
+	static constexpr uint32_t null = std::numeric_limits<uint32_t>::max();
+
+	explicit TagIndex(entt::registry& registry) : registry(registry) {}
+
+	uint32_t intern(const std::string& tag);
+	// Returns TagIndex::null if the tag was never interned.
+	uint32_t find(const std::string& tag) const;
+
+	void insert(entt::entity entity, TagComponent& component);
+	void erase(TagComponent& component);
+	void rename(TagComponent& component, const std::string& tag);
+
+	const std::vector<entt::entity>& getEntities(uint32_t id) const { return buckets[id]; }
+
+private:
+	entt::registry& registry;
+	std::unordered_map<std::string, uint32_t> ids;
+	// deque keeps bucket references valid while new tags are interned
+	std::deque<std::vector<entt::entity>> buckets;
+};
+
+}
+
+#endif//GECS_TAGINDEX_H
@@ -0,0 +1,113 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_TEXTUREATLAS_H
+#define GECS_TEXTUREATLAS_H
+
+#include "gImage.h"
+
+#include <memory>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Square RGBA texture that small sprites are packed into with a skyline
+ * packer. Released rects are kept in a free list and reused before the
+ * skyline grows. Packing only writes the CPU copy, the rect touched since
+ * the last upload is sent on the next getTexture().
+ */
+class AtlasPage {
+public:
+	explicit AtlasPage(int size);
+
+	AtlasPage(const AtlasPage&) = delete;
+	AtlasPage& operator=(const AtlasPage&) = delete;
+
+	/*
+	 * Copies an 8 bit image with 1 to 4 channels into the page. Returns
+	 * false if there is no room left.
+	 */
+	bool pack(const unsigned char* pixels, int width, int height, int channels, int& x, int& y);
+
+	// Gives a packed rect back to the page once nothing draws it anymore
+	void release(int x, int y, int width, int height);
+
+	// Copies a rect of the CPU copy into out as tightly packed RGBA rows
+	void copyRect(int x, int y, int width, int height, std::vector<unsigned char>& out) const;
+
+	// Must be called from the main thread
+	std::shared_ptr<gImage> getTexture();
+
+	int getSize() const { return size; }
+	// bytes of the CPU copy, the texture takes as much on the GPU
+	size_t getByteSize() const { return pixels.size(); }
+
+private:
+	struct SkylineNode {
+		int x;
+		int y;
+		int width;
+	};
+
+	struct Rect {
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	// y the rect would land on when placed at node index, -1 if it doesn't fit
+	int fit(size_t index, int width, int height) const;
+	void addSkylineLevel(size_t index, int x, int y, int width, int height);
+	bool takeFreeRect(int width, int height, int& x, int& y);
+	void markDirty(int x, int y, int width, int height);
+
+	int size;
+	std::vector<unsigned char> pixels;
+	std::vector<SkylineNode> skyline;
+	// padded rects released by their sprites
+	std::vector<Rect> freerects;
+	std::shared_ptr<gImage> texture;
+	// bounds of the texels changed since the last upload, empty when min >= max
+	int dirtyminx = 0;
+	int dirtyminy = 0;
+	int dirtymaxx = 0;
+	int dirtymaxy = 0;
+};
+
+struct AtlasRegion {
+	std::shared_ptr<AtlasPage> page;
+	// in pixels, origin at the top left of the page
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+
+	bool isValid() const { return page != nullptr; }
+};
+
+class TextureAtlas {
+public:
+	// Sprites larger than maxspritesize on either side keep their own texture
+	explicit TextureAtlas(int pagesize = 2048, int maxspritesize = 256);
+
+	// Returns an invalid region if the image isn't suitable for the atlas
+	AtlasRegion pack(const unsigned char* pixels, int width, int height, int channels);
+
+	// Drops pages no region refers to anymore
+	void releaseUnusedPages();
+
+	size_t getPageCount() const { return pages.size(); }
+	size_t getByteSize() const;
+
+private:
+	int pagesize;
+	int maxspritesize;
+	std::vector<std::shared_ptr<AtlasPage>> pages;
+};
+
+}
+
+#endif//GECS_TEXTUREATLAS_H
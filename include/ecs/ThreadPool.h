@@ -0,0 +1,65 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_THREADPOOL_H
+#define GECS_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gecs {
+
+class ThreadPool {
+public:
+	// workercount does not include the calling thread, which also takes part in dispatch()
+	explicit ThreadPool(size_t workercount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/*
+	 * Pool shared by every scene, sized to the hardware concurrency.
+	 */
+	static ThreadPool& getShared();
+
+	/*
+	 * Index of the calling thread in the shared pool. Its workers are
+	 * numbered from 1 to getWorkerCount(), 0 is any other thread, workers of
+	 * other pools included.
+	 */
+	static size_t getThreadIndex();
+
+	size_t getWorkerCount() const { return workers.size(); }
+
+	/*
+	 * Runs job(i) for every i in [0, count) on the workers and the calling
+	 * thread, and returns once all of them finished.
+	 */
+	void dispatch(size_t count, const std::function<void(size_t)>& job);
+
+	/*
+	 * Queues a task and returns immediately. Runs it right away when the
+	 * pool has no workers.
+	 */
+	void submit(std::function<void()> task);
+
+private:
+	void workerLoop(size_t index);
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool isstopping = false;
+};
+
+}
+
+#endif//GECS_THREADPOOL_H
@@ -0,0 +1,59 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#ifndef GECS_TRANSFORMKERNEL_H
+#define GECS_TRANSFORMKERNEL_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace gecs {
+
+/*
+ * Computes the matrices of many transforms at once. Transforms are stored in
+ * blocks of 8 with one array per float, so compute() is a loop without
+ * branches over each block that the compiler turns into 4 or 8 wide SIMD
+ * code.
+ *
+ * The normal matrix of rotation R and scale S is R * S^-1, so no matrix is
+ * ever inverted, uniform scale or not.
+ */
+class TransformKernel {
+public:
+	void clear();
+	void reserve(size_t count);
+
+	void add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, const glm::vec3& pivot);
+
+	size_t size() const { return count; }
+
+	void compute();
+
+	// Results of transform i, valid after compute()
+	void getMatrices(size_t i, glm::mat4& matrix, glm::mat3& normalmatrix) const;
+
+	static constexpr size_t LANES = 8;
+
+private:
+	struct Block {
+		// x, y, z and for rotations w
+		float positions[3][LANES];
+		float rotations[4][LANES];
+		float scales[3][LANES];
+		float pivots[3][LANES];
+		// column major, the last column is the translation
+		float matrices[12][LANES];
+		float normals[9][LANES];
+	};
+
+	size_t count = 0;
+	std::vector<Block> blocks;
+};
+
+}
+
+#endif//GECS_TRANSFORMKERNEL_H
@@ -14,5 +14,20 @@
 #include "ecs/MouseCode.h"
 #include "ecs/KeyCode.h"
 #include "ecs/Ref.h"
+#include "ecs/Prefab.h"
+#include "ecs/CommandBuffer.h"
+#include "ecs/SystemScheduler.h"
+#include "ecs/ThreadPool.h"
+#include "ecs/TagIndex.h"
+#include "ecs/BakedImage.h"
+#include "ecs/TextureAtlas.h"
+#include "ecs/SpriteBatch.h"
+#include "ecs/ModelInstancer.h"
+#include "ecs/FrustumCuller.h"
+#include "ecs/SpatialIndex.h"
+#include "ecs/SpatialHashGrid.h"
+#include "ecs/DrawList.h"
+#include "ecs/TransformKernel.h"
+#include "ecs/ChangeTracker.h"
 
 #endif//GIPECS_GIPECS_H
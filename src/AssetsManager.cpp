@@ -3,6 +3,10 @@
 //
 
 #include "ecs/AssetsManager.h"
+#include "ecs/BakedImage.h"
+
+#include <algorithm>
+#include <filesystem>
 
 namespace gecs {
 /*
@@ -25,7 +29,23 @@ SpriteAsset::SpriteAsset(const std::string& assetpath)
 	image.loadImageData()
 }*/
 
+SpriteAsset::~SpriteAsset() {
+	if (region.isValid()) {
+		region.page->release(region.x, region.y, region.width, region.height);
+	}
+}
+
 void SpriteAsset::applyTo(gImage& image) {
+	if (region.isValid()) {
+		if (regionpixels.empty()) {
+			region.page->copyRect(region.x, region.y, region.width, region.height, regionpixels);
+		}
+		image.setData(regionpixels.data(), region.width, region.height, 4, false, false);
+		return;
+	}
+	if (!data.image) {
+		return;
+	}
 	if (data.ishdr) {
 		image.setDataHDR(static_cast<float*>(data.image), data.width, data.height, data.channels, false, false);
 	} else {
@@ -33,6 +53,17 @@ void SpriteAsset::applyTo(gImage& image) {
 	}
 }
 
+std::shared_ptr<gImage> SpriteAsset::getTexture() {
+	if (region.isValid()) {
+		return region.page->getTexture();
+	}
+	if (!texture) {
+		texture = std::make_shared<gImage>();
+		applyTo(*texture);
+	}
+	return texture;
+}
+
 void SkyboxAsset::applyTo(gSkybox& skybox) {
 	std::array<int, 6> widths{};
 	std::array<int, 6> heights{};
@@ -47,53 +78,431 @@ void SkyboxAsset::applyTo(gSkybox& skybox) {
 	skybox.loadSkybox(widths, heights, rawdata, ishdr);
 }
 
-AssetsManager::AssetsManager() {
+size_t SkyboxAsset::getByteSize() const {
+	size_t bytes = 0;
+	for (const ImageData& face : faces) {
+		bytes += face.getByteSize();
+	}
+	return bytes;
+}
+
+AssetState AssetHandle::getState() const {
+	return state ? state->state.load() : AssetState::FAILED;
+}
+
+std::shared_ptr<AssetBase> AssetHandle::get() const {
+	if (!isLoaded()) {
+		return nullptr;
+	}
+	return state->asset;
+}
+
+void AssetHandle::onLoaded(Callback callback) const {
+	if (!state) {
+		return;
+	}
+	if (isLoaded()) {
+		callback(state->asset);
+	} else if (getState() == AssetState::LOADING) {
+		state->callbacks.push_back(std::move(callback));
+	}
+}
+
+static constexpr uint64_t fnvoffset = 14695981039346656037ull;
+static constexpr uint64_t fnvprime = 1099511628211ull;
+
+static uint64_t hashCombine(uint64_t seed, uint64_t value) {
+	for (size_t i = 0; i < sizeof(value); i++) {
+		seed = (seed ^ ((value >> (i * 8)) & 0xff)) * fnvprime;
+	}
+	return seed;
+}
+
+static size_t getImageCount(AssetType type) {
+	return type == AssetType::STATIC_SKYBOX_6 ? 6 : 1;
+}
 
+static int getDesiredChannels(AssetType type) {
+	return type == AssetType::STATIC_SKYBOX_6 ? 3 : 0;
+}
+
+// The same bytes decoded as another asset type give different pixels
+static uint64_t makeContentKey(AssetType type, const std::array<uint64_t, 6>& hashes) {
+	uint64_t key = hashCombine(fnvoffset, static_cast<uint64_t>(type));
+	for (size_t i = 0; i < getImageCount(type); i++) {
+		key = hashCombine(key, hashes[i]);
+	}
+	return key;
+}
+
+static std::string normalizePath(const std::string& path) {
+	return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+static std::string makePathKey(AssetType type, const std::vector<std::string>& paths) {
+	std::string key = std::to_string(static_cast<int>(type));
+	for (const std::string& path : paths) {
+		key += '|';
+		key += path;
+	}
+	return key;
+}
+
+// A mapped source or baked file, hashed but not decoded yet
+struct SourceImage {
+	std::shared_ptr<MappedFile> file;
+	uint64_t hash = 0;
+};
+
+// Safe to call from any thread, logging is left to the caller
+static bool openImage(const std::string& path, SourceImage& source) {
+	source.file = MappedFile::open(gObject::gGetAssetsDir() + path);
+	if (!source.file) {
+		return false;
+	}
+	// Baked files carry the hash of their source, no need to touch the pixels
+	if (const BakedImageHeader* header = BakedImage::getHeader(*source.file)) {
+		source.hash = header->sourcehash;
+	} else {
+		source.hash = BakedImage::hashSource(source.file->getData(), source.file->getSize());
+	}
+	return true;
+}
+
+static bool decodeImage(SourceImage& source, int desiredchannels, ImageData& data) {
+	if (BakedImage::getHeader(*source.file)) {
+		return BakedImage::load(std::move(source.file), desiredchannels, data);
+	}
+	const stbi_uc* buffer = source.file->getData();
+	int length = static_cast<int>(source.file->getSize());
+	data.ishdr = stbi_is_hdr_from_memory(buffer, length);
+	if (data.ishdr) {
+		data.image = stbi_loadf_from_memory(buffer, length, &data.width, &data.height, &data.channels, desiredchannels);
+	} else {
+		data.image = stbi_load_from_memory(buffer, length, &data.width, &data.height, &data.channels, desiredchannels);
+	}
+	if (desiredchannels != 0) {
+		data.channels = desiredchannels;
+	}
+	// The encoded file isn't needed once decoded
+	source.file.reset();
+	return data.image != nullptr;
+}
+
+static std::shared_ptr<AssetBase> makeAsset(AssetType type, std::array<ImageData, 6>& images) {
+	if (type == AssetType::STATIC_SKYBOX_6) {
+		return std::make_shared<SkyboxAsset>(std::move(images));
+	}
+	return std::make_shared<SpriteAsset>(std::move(images[0]));
+}
+
+static void logLoadFailure(const std::string& path) {
+	gLoge("AssetsManager") << "Failed to to load asset at " << path << " (" << gObject::gGetAssetsDir() + path << ")";
+}
+
+void AssetsManager::LoadQueue::push(CompletedLoad load) {
+	std::lock_guard<std::mutex> lock(mutex);
+	completed.push_back(std::move(load));
+}
+
+AssetsManager::AssetsManager(size_t loadercount)
+	: loadqueue(std::make_shared<LoadQueue>()), loader(std::make_unique<ThreadPool>(loadercount)) {
 }
 
 void AssetsManager::createStaticSkybox6(std::array<std::string, 6> paths, const std::string& ref) {
-	std::array<ImageData, 6> data{};
-	for (size_t i = 0; i < 6; i++) {
-		const std::string& path = paths[i];
-		std::string fullpath = gObject::gGetAssetsDir() + path;
-		bool ishdr = stbi_is_hdr(fullpath.c_str());
-		if (ishdr) {
-			data[i].image = stbi_loadf(fullpath.c_str(), &data[i].width, &data[i].height, &data[i].channels, 3);
-		} else {
-			data[i].image = stbi_load(fullpath.c_str(), &data[i].width, &data[i].height, &data[i].channels, 3);
+	if (CacheEntry* entry = loadCached(AssetType::STATIC_SKYBOX_6, {paths.begin(), paths.end()})) {
+		refs[ref] = entry->contentkey;
+	}
+	evictUnused();
+}
+
+void AssetsManager::createStaticSprite(const std::string& path, const std::string& ref) {
+	if (CacheEntry* entry = loadCached(AssetType::STATIC_SPRITE, {path})) {
+		refs[ref] = entry->contentkey;
+	}
+	evictUnused();
+}
+
+AssetHandle AssetsManager::loadStaticSkybox6Async(std::array<std::string, 6> paths, const std::string& ref) {
+	return loadAsync(AssetType::STATIC_SKYBOX_6, {paths.begin(), paths.end()}, ref);
+}
+
+AssetHandle AssetsManager::loadStaticSpriteAsync(const std::string& path, const std::string& ref) {
+	return loadAsync(AssetType::STATIC_SPRITE, {path}, ref);
+}
+
+AssetsManager::CacheEntry* AssetsManager::loadCached(AssetType type, const std::vector<std::string>& paths) {
+	std::vector<std::string> normalized;
+	normalized.reserve(paths.size());
+	for (const std::string& path : paths) {
+		normalized.push_back(normalizePath(path));
+	}
+	std::string pathkey = makePathKey(type, normalized);
+	auto indexed = pathindex.find(pathkey);
+	if (indexed != pathindex.end()) {
+		CacheEntry& entry = cache.at(indexed->second);
+		if (entry.asset) {
+			stats.hits++;
+			touch(entry);
+			return &entry;
 		}
+	}
 
-		if (!data[i].image) {
-			gLoge("AssetsManager") << "Failed to to load asset at " << path << " (" << fullpath << ")";
-			return;
+	// Hash the files before decoding so duplicates under other paths are found
+	size_t count = getImageCount(type);
+	std::array<SourceImage, 6> sources;
+	std::array<uint64_t, 6> hashes{};
+	for (size_t i = 0; i < count; i++) {
+		if (!openImage(normalized[i], sources[i])) {
+			logLoadFailure(normalized[i]);
+			return nullptr;
 		}
+		hashes[i] = sources[i].hash;
+	}
+	uint64_t contentkey = makeContentKey(type, hashes);
+	pathindex[pathkey] = contentkey;
+	auto cached = cache.find(contentkey);
+	if (cached != cache.end() && cached->second.asset) {
+		stats.hits++;
+		touch(cached->second);
+		return &cached->second;
 	}
-	assets[ref] = std::make_shared<SkyboxAsset>(std::move(data));
+
+	stats.misses++;
+	std::array<ImageData, 6> images{};
+	for (size_t i = 0; i < count; i++) {
+		if (!decodeImage(sources[i], getDesiredChannels(type), images[i])) {
+			logLoadFailure(normalized[i]);
+			return nullptr;
+		}
+	}
+	return &insertEntry(contentkey, type, std::move(normalized), makeAsset(type, images));
 }
 
-void AssetsManager::createStaticSprite(const std::string& path, const std::string& ref) {
-	std::string fullpath = gObject::gGetAssetsDir() + path;
-	bool ishdr = stbi_is_hdr(fullpath.c_str());
-	void* data;
-	int width, height, channels;
-	if (ishdr) {
-		data = stbi_loadf(fullpath.c_str(), &width, &height, &channels, 0);
-	} else {
-		data = stbi_load(fullpath.c_str(), &width, &height, &channels, 0);
+AssetsManager::CacheEntry& AssetsManager::insertEntry(uint64_t contentkey, AssetType type, std::vector<std::string> paths, std::shared_ptr<AssetBase> asset) {
+	CacheEntry& entry = cache[contentkey];
+	if (entry.asset) {
+		stats.residentbytes -= entry.bytes;
+	}
+	entry.contentkey = contentkey;
+	entry.type = type;
+	entry.paths = std::move(paths);
+	entry.asset = std::move(asset);
+	if (type == AssetType::STATIC_SPRITE && isatlasenabled) {
+		auto sprite = std::static_pointer_cast<SpriteAsset>(entry.asset);
+		ImageData& data = sprite->data;
+		if (!data.ishdr) {
+			sprite->region = atlas.pack(static_cast<const unsigned char*>(data.image), data.width, data.height, data.channels);
+		}
+		// The page holds the only copy of the pixels the asset needs
+		if (sprite->region.isValid()) {
+			data.release();
+			updateAtlasBytes();
+		}
 	}
+	entry.bytes = entry.asset->getByteSize();
+	stats.residentbytes += entry.bytes;
+	touch(entry);
+	return entry;
+}
 
-	if (!data) {
-		gLoge("AssetsManager") << "Failed to to load asset at " << path << " (" << fullpath << ")";
-		return;
+void AssetsManager::touch(CacheEntry& entry) {
+	entry.lastused = ++accesstick;
+}
+
+void AssetsManager::updateAtlasBytes() {
+	size_t bytes = atlas.getByteSize();
+	stats.residentbytes = stats.residentbytes - atlasbytes + bytes;
+	atlasbytes = bytes;
+}
+
+AssetHandle AssetsManager::loadAsync(AssetType type, const std::vector<std::string>& paths, const std::string& ref) {
+	std::vector<std::string> normalized;
+	normalized.reserve(paths.size());
+	for (const std::string& path : paths) {
+		normalized.push_back(normalizePath(path));
+	}
+	std::string pathkey = makePathKey(type, normalized);
+
+	auto indexed = pathindex.find(pathkey);
+	if (indexed != pathindex.end()) {
+		CacheEntry& entry = cache.at(indexed->second);
+		if (entry.asset) {
+			stats.hits++;
+			touch(entry);
+			refs[ref] = entry.contentkey;
+			auto state = std::make_shared<AssetHandle::State>();
+			state->asset = entry.asset;
+			state->state = AssetState::LOADED;
+			return AssetHandle(state);
+		}
+	}
+
+	// Requests for a path that is already being decoded share its load
+	auto pending = pendingloads.find(pathkey);
+	if (pending != pendingloads.end()) {
+		pending->second.refs.push_back(ref);
+		return AssetHandle(pending->second.state);
+	}
+	PendingLoad& load = pendingloads[pathkey];
+	load.state = std::make_shared<AssetHandle::State>();
+	load.refs.push_back(ref);
+
+	struct Decode {
+		std::array<ImageData, 6> images;
+		std::array<uint64_t, 6> hashes{};
+		std::array<bool, 6> isfailed{};
+		std::atomic<size_t> remaining{0};
+		CompletedLoad result;
+	};
+	auto decode = std::make_shared<Decode>();
+	size_t count = getImageCount(type);
+	decode->remaining = count;
+	decode->result.pathkey = pathkey;
+	decode->result.type = type;
+	decode->result.paths = std::move(normalized);
+
+	// Every image decodes as its own task, the last one to finish hands the asset over
+	std::shared_ptr<LoadQueue> queue = loadqueue;
+	for (size_t i = 0; i < count; i++) {
+		loader->submit([decode, queue, i]() {
+			AssetType type = decode->result.type;
+			SourceImage source;
+			bool isloaded = openImage(decode->result.paths[i], source);
+			if (isloaded) {
+				decode->hashes[i] = source.hash;
+				isloaded = decodeImage(source, getDesiredChannels(type), decode->images[i]);
+			}
+			decode->isfailed[i] = !isloaded;
+			if (decode->remaining.fetch_sub(1) != 1) {
+				return;
+			}
+			CompletedLoad& result = decode->result;
+			for (size_t image = 0; image < getImageCount(type); image++) {
+				if (decode->isfailed[image]) {
+					result.failedpaths.push_back(result.paths[image]);
+				}
+			}
+			if (result.failedpaths.empty()) {
+				result.contentkey = makeContentKey(type, decode->hashes);
+				result.asset = makeAsset(type, decode->images);
+			}
+			queue->push(std::move(result));
+		});
 	}
-	assets[ref] = std::make_shared<SpriteAsset>(ImageData{width, height, channels, ishdr, data});
+	return AssetHandle(load.state);
 }
 
+void AssetsManager::processLoadQueue() {
+	std::vector<CompletedLoad> completed;
+	{
+		std::lock_guard<std::mutex> lock(loadqueue->mutex);
+		completed.swap(loadqueue->completed);
+	}
+	// Textures are uploaded after the loop so every atlas page is uploaded once
+	std::vector<std::shared_ptr<SpriteAsset>> sprites;
+	std::vector<std::shared_ptr<AssetHandle::State>> loaded;
+	for (CompletedLoad& load : completed) {
+		auto pending = pendingloads.find(load.pathkey);
+		PendingLoad request = std::move(pending->second);
+		pendingloads.erase(pending);
+		for (const std::string& path : load.failedpaths) {
+			logLoadFailure(path);
+		}
+		if (!load.asset) {
+			request.state->state = AssetState::FAILED;
+			request.state->callbacks.clear();
+			continue;
+		}
+
+		// Content decoded under another path is replaced by the cached asset
+		pathindex[load.pathkey] = load.contentkey;
+		auto cached = cache.find(load.contentkey);
+		CacheEntry* entry;
+		if (cached != cache.end() && cached->second.asset) {
+			stats.hits++;
+			entry = &cached->second;
+			touch(*entry);
+		} else {
+			stats.misses++;
+			entry = &insertEntry(load.contentkey, load.type, std::move(load.paths), std::move(load.asset));
+		}
+		for (const std::string& ref : request.refs) {
+			refs[ref] = load.contentkey;
+		}
+		if (entry->type == AssetType::STATIC_SPRITE) {
+			sprites.push_back(std::static_pointer_cast<SpriteAsset>(entry->asset));
+		}
+		request.state->asset = entry->asset;
+		request.state->state = AssetState::LOADED;
+		loaded.push_back(std::move(request.state));
+	}
+	for (const std::shared_ptr<SpriteAsset>& sprite : sprites) {
+		sprite->getTexture();
+	}
+	for (const std::shared_ptr<AssetHandle::State>& state : loaded) {
+		std::vector<AssetHandle::Callback> callbacks;
+		callbacks.swap(state->callbacks);
+		for (AssetHandle::Callback& callback : callbacks) {
+			callback(state->asset);
+		}
+	}
+	evictUnused();
+}
 
 std::shared_ptr<AssetBase> AssetsManager::getAsset(const std::string& ref) {
-	return assets[ref];
+	auto it = refs.find(ref);
+	if (it == refs.end()) {
+		return nullptr;
+	}
+	CacheEntry& entry = cache.at(it->second);
+	if (entry.asset) {
+		stats.hits++;
+		touch(entry);
+		return entry.asset;
+	}
+	// Evicted, decode it again. The files may have changed since.
+	std::vector<std::string> paths = entry.paths;
+	CacheEntry* reloaded = loadCached(entry.type, paths);
+	if (!reloaded) {
+		return nullptr;
+	}
+	it->second = reloaded->contentkey;
+	std::shared_ptr<AssetBase> asset = reloaded->asset;
+	evictUnused();
+	return asset;
 }
 
+void AssetsManager::setMemoryBudget(size_t bytes) {
+	memorybudget = bytes;
+	evictUnused();
+}
 
+void AssetsManager::evictUnused() {
+	if (stats.residentbytes <= memorybudget) {
+		return;
+	}
+	// The entry's own reference is the only one left when nobody uses the asset
+	std::vector<CacheEntry*> unused;
+	for (auto& [contentkey, entry] : cache) {
+		if (entry.asset && entry.asset.use_count() == 1) {
+			unused.push_back(&entry);
+		}
+	}
+	std::sort(unused.begin(), unused.end(), [](const CacheEntry* a, const CacheEntry* b) {
+		return a->lastused < b->lastused;
+	});
+	for (CacheEntry* entry : unused) {
+		if (stats.residentbytes <= memorybudget) {
+			break;
+		}
+		stats.residentbytes -= entry->bytes;
+		entry->asset.reset();
+		entry->bytes = 0;
+		stats.evictions++;
+	}
+	atlas.releaseUnusedPages();
+	updateAtlasBytes();
+}
 
-}
\ No newline at end of file
+}
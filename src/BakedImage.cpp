@@ -0,0 +1,177 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/BakedImage.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace gecs {
+
+static size_t alignUp(size_t value) {
+	return (value + BakedImage::alignment - 1) & ~(BakedImage::alignment - 1);
+}
+
+// Box filters one level down, odd edges repeat their last texel
+template<typename T>
+static std::vector<unsigned char> downsample(const unsigned char* source, uint32_t width, uint32_t height, uint32_t channels) {
+	uint32_t mipwidth = std::max(1u, width / 2);
+	uint32_t mipheight = std::max(1u, height / 2);
+	std::vector<unsigned char> mip(static_cast<size_t>(mipwidth) * mipheight * channels * sizeof(T));
+	const T* in = reinterpret_cast<const T*>(source);
+	T* out = reinterpret_cast<T*>(mip.data());
+	for (uint32_t y = 0; y < mipheight; y++) {
+		uint32_t y0 = std::min(y * 2, height - 1);
+		uint32_t y1 = std::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < mipwidth; x++) {
+			uint32_t x0 = std::min(x * 2, width - 1);
+			uint32_t x1 = std::min(x * 2 + 1, width - 1);
+			for (uint32_t c = 0; c < channels; c++) {
+				float sum = static_cast<float>(in[(y0 * width + x0) * channels + c])
+						  + static_cast<float>(in[(y0 * width + x1) * channels + c])
+						  + static_cast<float>(in[(y1 * width + x0) * channels + c])
+						  + static_cast<float>(in[(y1 * width + x1) * channels + c]);
+				if constexpr (std::is_floating_point_v<T>) {
+					out[(y * mipwidth + x) * channels + c] = sum * 0.25f;
+				} else {
+					out[(y * mipwidth + x) * channels + c] = static_cast<T>(sum * 0.25f + 0.5f);
+				}
+			}
+		}
+	}
+	return mip;
+}
+
+bool BakedImage::bake(const std::string& sourcepath, const std::string& bakedpath, int desiredchannels, bool generatemips) {
+	std::shared_ptr<MappedFile> source = MappedFile::open(gObject::gGetAssetsDir() + sourcepath);
+	if (!source) {
+		gLoge("BakedImage") << "Failed to open " << sourcepath;
+		return false;
+	}
+	const stbi_uc* buffer = source->getData();
+	int length = static_cast<int>(source->getSize());
+	int width, height, channels;
+	bool ishdr = stbi_is_hdr_from_memory(buffer, length);
+	void* pixels;
+	if (ishdr) {
+		pixels = stbi_loadf_from_memory(buffer, length, &width, &height, &channels, desiredchannels);
+	} else {
+		pixels = stbi_load_from_memory(buffer, length, &width, &height, &channels, desiredchannels);
+	}
+	if (!pixels) {
+		gLoge("BakedImage") << "Failed to decode " << sourcepath << ": " << stbi_failure_reason();
+		return false;
+	}
+
+	BakedImageHeader header{};
+	header.magic = magic;
+	header.version = version;
+	header.sourcehash = hashSource(source->getData(), source->getSize());
+	// Forcing other channels gives other pixels than loading the source
+	if (desiredchannels != 0 && desiredchannels != channels) {
+		header.sourcehash ^= static_cast<uint64_t>(desiredchannels) * 0x9e3779b97f4a7c15ull;
+		channels = desiredchannels;
+	}
+	header.width = width;
+	header.height = height;
+	header.channels = channels;
+	header.ishdr = ishdr;
+
+	size_t texel = static_cast<size_t>(channels) * (ishdr ? sizeof(float) : sizeof(unsigned char));
+	std::vector<std::vector<unsigned char>> levels;
+	levels.emplace_back(static_cast<unsigned char*>(pixels), static_cast<unsigned char*>(pixels) + texel * width * height);
+	stbi_image_free(pixels);
+	uint32_t mipwidth = width;
+	uint32_t mipheight = height;
+	while (generatemips && levels.size() < BakedImageHeader::maxmips && (mipwidth > 1 || mipheight > 1)) {
+		if (ishdr) {
+			levels.push_back(downsample<float>(levels.back().data(), mipwidth, mipheight, channels));
+		} else {
+			levels.push_back(downsample<unsigned char>(levels.back().data(), mipwidth, mipheight, channels));
+		}
+		mipwidth = std::max(1u, mipwidth / 2);
+		mipheight = std::max(1u, mipheight / 2);
+	}
+
+	header.mipcount = static_cast<uint32_t>(levels.size());
+	size_t offset = alignUp(sizeof(BakedImageHeader));
+	mipwidth = width;
+	mipheight = height;
+	for (size_t i = 0; i < levels.size(); i++) {
+		header.mips[i] = BakedMip{offset, mipwidth, mipheight};
+		offset = alignUp(offset + levels[i].size());
+		mipwidth = std::max(1u, mipwidth / 2);
+		mipheight = std::max(1u, mipheight / 2);
+	}
+
+	std::ofstream file(gObject::gGetAssetsDir() + bakedpath, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		gLoge("BakedImage") << "Failed to create " << bakedpath;
+		return false;
+	}
+	static const char padding[alignment] = {};
+	size_t written = sizeof(BakedImageHeader);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(BakedImageHeader));
+	for (size_t i = 0; i < levels.size(); i++) {
+		file.write(padding, static_cast<std::streamsize>(header.mips[i].offset - written));
+		file.write(reinterpret_cast<const char*>(levels[i].data()), static_cast<std::streamsize>(levels[i].size()));
+		written = header.mips[i].offset + levels[i].size();
+	}
+	if (!file) {
+		gLoge("BakedImage") << "Failed to write " << bakedpath;
+		return false;
+	}
+	return true;
+}
+
+const BakedImageHeader* BakedImage::getHeader(const MappedFile& file) {
+	if (file.getSize() < sizeof(BakedImageHeader)) {
+		return nullptr;
+	}
+	const auto* header = reinterpret_cast<const BakedImageHeader*>(file.getData());
+	if (header->magic != magic || header->version != version) {
+		return nullptr;
+	}
+	if (header->mipcount == 0 || header->mipcount > BakedImageHeader::maxmips) {
+		return nullptr;
+	}
+	size_t texel = static_cast<size_t>(header->channels) * (header->ishdr ? sizeof(float) : sizeof(unsigned char));
+	for (uint32_t i = 0; i < header->mipcount; i++) {
+		const BakedMip& mip = header->mips[i];
+		size_t bytes = texel * mip.width * mip.height;
+		if (mip.offset % alignment != 0 || mip.offset > file.getSize() || bytes > file.getSize() - mip.offset) {
+			return nullptr;
+		}
+	}
+	return header;
+}
+
+bool BakedImage::load(std::shared_ptr<MappedFile> file, int desiredchannels, ImageData& data) {
+	const BakedImageHeader* header = getHeader(*file);
+	if (!header) {
+		return false;
+	}
+	if (desiredchannels != 0 && static_cast<uint32_t>(desiredchannels) != header->channels) {
+		return false;
+	}
+	data.width = static_cast<int>(header->width);
+	data.height = static_cast<int>(header->height);
+	data.channels = static_cast<int>(header->channels);
+	data.ishdr = header->ishdr != 0;
+	data.image = file->getData() + header->mips[0].offset;
+	data.mapping = std::move(file);
+	return true;
+}
+
+uint64_t BakedImage::hashSource(const unsigned char* bytes, size_t size) {
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+}
@@ -9,6 +9,29 @@
 
 namespace gecs {
 
+BehaviorsComponent::BehaviorsComponent(const BehaviorsComponent& other) {
+	*this = other;
+}
+
+BehaviorsComponent& BehaviorsComponent::operator=(const BehaviorsComponent& other) {
+	if (this == &other) {
+		return *this;
+	}
+	behaviors.clear();
+	cloners = other.cloners;
+	for (auto&& pair : other.behaviors) {
+		auto it = cloners.find(pair.first);
+		if (it == cloners.end()) {
+			gLogw("BehaviorsComponent") << "Behavior " << pair.first.name() << " is not copyable, it is left out of the copy";
+			continue;
+		}
+		behaviors[pair.first] = it->second(*pair.second);
+	}
+	// The copy belongs to another entity, start it again
+	firstupdate = true;
+	return *this;
+}
+
 void BehaviorsComponent::onUpdate(Entity entity, float deltatime) {
 	if (firstupdate) {
 		// This should be moved out
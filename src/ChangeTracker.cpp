@@ -0,0 +1,24 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/ChangeTracker.h"
+#include "ecs/ThreadPool.h"
+
+namespace gecs {
+
+ChangeTracker::ChangeTracker() : lists(ThreadPool::getShared().getWorkerCount() + 1) {}
+
+void ChangeTracker::mark(entt::entity handle) {
+	lists[ThreadPool::getThreadIndex()].push_back(handle);
+}
+
+void ChangeTracker::collect(std::vector<entt::entity>& changed) {
+	changed.clear();
+	for (std::vector<entt::entity>& list : lists) {
+		changed.insert(changed.end(), list.begin(), list.end());
+		list.clear();
+	}
+}
+
+}
@@ -0,0 +1,49 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/CommandBuffer.h"
+#include "ecs/Scene.h"
+
+namespace gecs {
+
+entt::entity CommandBuffer::createEntity(const std::string& name) {
+	return createEntityWithUUID(gUUID(), name);
+}
+
+entt::entity CommandBuffer::createEntityWithUUID(gUUID uuid, const std::string& name) {
+	requestedhandles++;
+	// Outside of a deferring phase nothing else reads the registry
+	if (reservedhandles.empty() && !scene->isDeferring()) {
+		reservedhandles.push_back(scene->registry.create());
+	}
+	// Creating one here would race with the threads reading the registry
+	if (reservedhandles.empty()) {
+		if (!isreserveempty) {
+			gLoge("CommandBuffer") << "Out of reserved entity handles, raise Scene::setDeferredEntityReserve";
+			isreserveempty = true;
+		}
+		return entt::null;
+	}
+	entt::entity handle = reservedhandles.back();
+	reservedhandles.pop_back();
+	creates.push_back({handle, uuid, name});
+	isempty = false;
+	return handle;
+}
+
+void CommandBuffer::removeEntity(entt::entity handle) {
+	removedentities.push_back(handle);
+	isempty = false;
+}
+
+void CommandBuffer::clear() {
+	creates.clear();
+	removedentities.clear();
+	for (auto& [type, pool] : pools) {
+		pool->clear();
+	}
+	isempty = true;
+}
+
+}
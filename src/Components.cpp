@@ -3,30 +3,55 @@
 //
 
 #include "ecs/Components.h"
+#include "ecs/TagIndex.h"
 #include "gTracy.h"
 
+#include <algorithm>
+
 namespace gecs {
 
+void TagComponent::setTag(const std::string& newtag) {
+	if (index) {
+		index->rename(*this, newtag);
+	} else {
+		tag = newtag;
+	}
+}
+
 void SpriteComponent::setAsset(std::shared_ptr<AssetBase> asset) {
-	std::shared_ptr<SpriteAsset> sprite = std::reinterpret_pointer_cast<SpriteAsset>(asset);
-	if (sprite) {
-		sprite->applyTo(data);
+	if (asset && asset->getType() == AssetType::STATIC_SPRITE) {
+		this->asset = std::static_pointer_cast<SpriteAsset>(asset);
+		data = this->asset->getTexture();
+		region = this->asset->getAtlasRegion();
 	}
 }
 
+void CameraComponent::allocate(int screenwidth, int screenheight) {
+	int width = std::max(1, static_cast<int>(screenwidth * resolutionscale));
+	int height = std::max(1, static_cast<int>(screenheight * resolutionscale));
+	if (width == allocatedwidth && height == allocatedheight) {
+		return;
+	}
+	fbo.allocate(width, height);
+	allocatedwidth = width;
+	allocatedheight = height;
+}
+
+void CameraComponent::updateView(glm::vec3 position, glm::mat4 transformationmatrix) {
+	aspectratio = allocatedwidth / static_cast<float>(allocatedheight);
+	data.updateFrustum(position, transformationmatrix, nearplane, farplane, aspectratio, glm::radians(fov));
+}
+
+// updateView must be called first
 void CameraComponent::begin(glm::vec3 position, glm::mat4 transformationmatrix) {
 	G_PROFILE_ZONE_SCOPED_N("CameraComponent::begin()");
 	gRenderer* renderer = gRenderObject::getRenderer();
 	renderer->backupMatrices();
-	float fovY = glm::radians(fov);
-	aspectratio = fbo.getWidth() / static_cast<float>(fbo.getHeight());
-	renderer->setProjectionMatrix(glm::perspective(fovY, aspectratio, nearplane, farplane));
+	renderer->setProjectionMatrix(glm::perspective(glm::radians(fov), aspectratio, nearplane, farplane));
 	renderer->setViewMatrix(glm::inverse(transformationmatrix));
 	renderer->setCameraPosition(position);
 	renderer->setCamera(&data);
 	if(renderer->isGridEnabled()) renderer->drawGrid();
-
-	data.updateFrustum(position, transformationmatrix, nearplane, farplane, aspectratio, fovY);
 	renderer->updateScene();
 }
 
@@ -38,58 +63,76 @@ void CameraComponent::end() {
 	renderer->updateScene();
 }
 
-glm::vec3 TransformComponent::getForward() {
-	return -transformmatrix[2];
+TransformComponent& TransformComponent::operator=(const TransformComponent& other) {
+	position = other.position;
+	rotation = other.rotation;
+	scale = other.scale;
+	pivot = other.pivot;
+	markChanged();
+	return *this;
+}
+
+glm::vec3 TransformComponent::getForward() const {
+	return rotation * glm::vec3(0.0f, 0.0f, -1.0f);
 }
 
-glm::vec3 TransformComponent::getBackward() {
-	return transformmatrix[2];
+glm::vec3 TransformComponent::getBackward() const {
+	return rotation * glm::vec3(0.0f, 0.0f, 1.0f);
 }
 
-glm::vec3 TransformComponent::getLeft() {
-	return -transformmatrix[0];
+glm::vec3 TransformComponent::getLeft() const {
+	return rotation * glm::vec3(-1.0f, 0.0f, 0.0f);
 }
 
-glm::vec3 TransformComponent::getRight() {
-	return transformmatrix[0];
+glm::vec3 TransformComponent::getRight() const {
+	return rotation * glm::vec3(1.0f, 0.0f, 0.0f);
 }
 
-glm::vec3 TransformComponent::getUp() {
-	return transformmatrix[1];
+glm::vec3 TransformComponent::getUp() const {
+	return rotation * glm::vec3(0.0f, 1.0f, 0.0f);
 }
 
-glm::vec3 TransformComponent::getDown() {
-	return -transformmatrix[1];
+glm::vec3 TransformComponent::getDown() const {
+	return rotation * glm::vec3(0.0f, -1.0f, 0.0f);
 }
 
 void TransformComponent::move(float dx, float dy, float dz) {
 	position += glm::vec3{dx, dy, dz};
-	ischanged = true;
+	markChanged();
 }
 
 void TransformComponent::setPosition(float x, float y, float z) {
 	position = glm::vec3{x, y, z};
-	ischanged = true;
+	markChanged();
 }
 
 void TransformComponent::rotate(float dx, float dy, float dz) {
-	rotation += glm::vec3{dx, dy, dz};
-	ischanged = true;
+	rotate(glm::quat(glm::radians(glm::vec3{dx, dy, dz})));
+}
+
+void TransformComponent::rotate(const glm::quat& delta) {
+	rotation = glm::normalize(rotation * delta);
+	markChanged();
 }
 
 void TransformComponent::setRotation(float x, float y, float z) {
-	rotation = glm::vec3{x, y, z};
-	ischanged = true;
+	rotation = glm::quat(glm::radians(glm::vec3{x, y, z}));
+	markChanged();
+}
+
+void TransformComponent::setOrientation(const glm::quat& orientation) {
+	rotation = glm::normalize(orientation);
+	markChanged();
 }
 
 void TransformComponent::resize(float dx, float dy, float dz) {
 	scale += glm::vec3{dx, dy, dz};
-	ischanged = true;
+	markChanged();
 }
 
 void TransformComponent::setScale(float x, float y, float z) {
 	scale = glm::vec3{x, y, z};
-	ischanged = true;
+	markChanged();
 }
 
 }
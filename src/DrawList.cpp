@@ -0,0 +1,76 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/DrawList.h"
+
+#include <algorithm>
+#include <array>
+
+namespace gecs {
+
+static constexpr uint64_t MATERIAL_BITS = 20;
+static constexpr uint64_t MESH_BITS = 16;
+static constexpr uint64_t DEPTH_BITS = 24;
+static constexpr uint64_t PASS_SHIFT = 60;
+
+uint64_t DrawList::makeKey(DrawPass pass, uint32_t material, uint32_t mesh, float depth) {
+	uint64_t maxdepth = (uint64_t(1) << DEPTH_BITS) - 1;
+	uint64_t quantized = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>(maxdepth));
+	uint64_t materialbits = material & ((uint64_t(1) << MATERIAL_BITS) - 1);
+	uint64_t meshbits = mesh & ((uint64_t(1) << MESH_BITS) - 1);
+	uint64_t key = static_cast<uint64_t>(pass) << PASS_SHIFT;
+	if (pass == DrawPass::TRANSLUCENT) {
+		key |= (maxdepth - quantized) << (MATERIAL_BITS + MESH_BITS);
+		key |= materialbits << MESH_BITS;
+		key |= meshbits;
+	} else {
+		key |= materialbits << (MESH_BITS + DEPTH_BITS);
+		key |= meshbits << DEPTH_BITS;
+		key |= quantized;
+	}
+	return key;
+}
+
+uint32_t DrawList::getId(std::unordered_map<const void*, uint32_t>& ids, const void* resource) {
+	// makeKey masks the id to the width of its field
+	auto it = ids.try_emplace(resource, static_cast<uint32_t>(ids.size())).first;
+	return it->second;
+}
+
+void DrawList::clear() {
+	commands.clear();
+	// Keys are only compared within one list, so ids can start over
+	materialids.clear();
+	meshids.clear();
+}
+
+void DrawList::sort() {
+	size_t count = commands.size();
+	if (count < 2) {
+		return;
+	}
+	scratch.resize(count);
+	std::array<size_t, 256> offsets{};
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		offsets.fill(0);
+		for (const DrawCommand& command : commands) {
+			offsets[(command.key >> shift) & 0xff]++;
+		}
+		if (offsets[(commands[0].key >> shift) & 0xff] == count) {
+			continue;
+		}
+		size_t total = 0;
+		for (size_t& offset : offsets) {
+			size_t bucket = offset;
+			offset = total;
+			total += bucket;
+		}
+		for (const DrawCommand& command : commands) {
+			scratch[offsets[(command.key >> shift) & 0xff]++] = command;
+		}
+		commands.swap(scratch);
+	}
+}
+
+}
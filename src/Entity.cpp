@@ -7,17 +7,18 @@
 
 namespace gecs {
 
-Entity::Entity(entt::entity handle, Scene* scene)
-	: entityhandle(handle), scene(scene) {
-	childhandles = nullptr;
-	parenthandle = entt::null;
-	if (isValid() && hasComponent<TreeComponent>()) {
-		TreeComponent& component = getComponent<TreeComponent>();
-		parenthandle = component.parent;
-		childhandles = &component.childs;
+entt::entity Entity::getParentHandle() const {
+	if (!isValid() || !hasComponent<TreeComponent>()) {
+		return entt::null;
 	}
+	return scene->getComponent<TreeComponent>(entityhandle).parent;
 }
 
-Entity::~Entity() {}
+const std::vector<entt::entity>* Entity::getChildHandles() const {
+	if (!isValid()) {
+		return nullptr;
+	}
+	return scene->getChildHandles(entityhandle);
+}
 
 }
@@ -0,0 +1,74 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/FrustumCuller.h"
+
+namespace gecs {
+
+// Arrays are padded to this many spheres so the plane loop has no tail
+static constexpr size_t lanewidth = 8;
+
+void FrustumCuller::clear() {
+	count = 0;
+	xs.clear();
+	ys.clear();
+	zs.clear();
+	radii.clear();
+}
+
+void FrustumCuller::reserve(size_t capacity) {
+	capacity += lanewidth;
+	xs.reserve(capacity);
+	ys.reserve(capacity);
+	zs.reserve(capacity);
+	radii.reserve(capacity);
+}
+
+void FrustumCuller::add(const glm::vec3& center, float radius) {
+	// Grown a full lane at a time, so the arrays are always padded
+	if (count == xs.size()) {
+		size_t padded = count + lanewidth;
+		xs.resize(padded, 0.0f);
+		ys.resize(padded, 0.0f);
+		zs.resize(padded, 0.0f);
+		radii.resize(padded, 0.0f);
+	}
+	xs[count] = center.x;
+	ys[count] = center.y;
+	zs[count] = center.z;
+	radii[count] = radius;
+	count++;
+}
+
+size_t FrustumCuller::cull(const Frustum& frustum, std::vector<uint8_t>& visible) const {
+	size_t padded = xs.size();
+	visible.assign(padded, 1);
+
+	const Plane* planes[] = {&frustum.nearFace, &frustum.farFace, &frustum.leftFace,
+							 &frustum.rightFace, &frustum.topFace, &frustum.bottomFace};
+	const float* x = xs.data();
+	const float* y = ys.data();
+	const float* z = zs.data();
+	const float* radius = radii.data();
+	uint8_t* out = visible.data();
+	for (const Plane* plane : planes) {
+		const float nx = plane->normal.x;
+		const float ny = plane->normal.y;
+		const float nz = plane->normal.z;
+		const float distance = plane->distance;
+		for (size_t i = 0; i < padded; i++) {
+			float signeddistance = nx * x[i] + ny * y[i] + nz * z[i] - distance;
+			out[i] &= static_cast<uint8_t>(signeddistance >= -radius[i]);
+		}
+	}
+
+	visible.resize(count);
+	size_t visiblecount = 0;
+	for (size_t i = 0; i < count; i++) {
+		visiblecount += visible[i];
+	}
+	return visiblecount;
+}
+
+}
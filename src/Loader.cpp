@@ -4,10 +4,61 @@
 
 #include "ecs/Loader.h"
 
+#include <limits>
+#include <unordered_map>
+
 namespace gecs {
 
+struct LoadedModel {
+	std::weak_ptr<gModel> model;
+	glm::vec4 bounds;
+};
+
+// A model stays shared for as long as a component uses it
+static std::unordered_map<std::string, LoadedModel> loadedmodels;
+
+// Sphere around the box of every mesh vertex
+static glm::vec4 computeBounds(gModel& model) {
+	glm::vec3 min(std::numeric_limits<float>::max());
+	glm::vec3 max(std::numeric_limits<float>::lowest());
+	for (int i = 0; i < model.getMeshNum(); i++) {
+		for (const gVertex& vertex : model.getMesh(i)->getVertices()) {
+			min = glm::min(min, vertex.position);
+			max = glm::max(max, vertex.position);
+		}
+	}
+	if (min.x > max.x) {
+		return {0.0f, 0.0f, 0.0f, -1.0f};
+	}
+	glm::vec3 center = (min + max) * 0.5f;
+	return glm::vec4(center, glm::length(max - center));
+}
+
 void Loader::loadModelComponent(ModelComponent& model, const std::string& modelpath) {
-	model.data.loadModel(modelpath);
+	auto found = loadedmodels.find(modelpath);
+	if (found != loadedmodels.end()) {
+		model.data = found->second.model.lock();
+		if (model.data) {
+			model.bounds = found->second.bounds;
+			model.markBoundsChanged();
+			return;
+		}
+	}
+	// Loading is rare next to drawing, so drop the paths nobody uses anymore here
+	for (auto it = loadedmodels.begin(); it != loadedmodels.end();) {
+		if (it->second.model.expired()) {
+			it = loadedmodels.erase(it);
+		} else {
+			it++;
+		}
+	}
+	model.data = std::make_shared<gModel>();
+	model.data->loadModel(modelpath);
+	LoadedModel& loaded = loadedmodels[modelpath];
+	loaded.model = model.data;
+	loaded.bounds = computeBounds(*model.data);
+	model.bounds = loaded.bounds;
+	model.markBoundsChanged();
 }
 
 
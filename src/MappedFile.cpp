@@ -0,0 +1,80 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gecs {
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mappinghandle) {
+		CloseHandle(mappinghandle);
+	}
+	if (filehandle) {
+		CloseHandle(filehandle);
+	}
+#else
+	if (data) {
+		munmap(data, size);
+	}
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& fullpath) {
+	std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(fullpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	file->filehandle = handle;
+	LARGE_INTEGER filesize;
+	if (!GetFileSizeEx(handle, &filesize) || filesize.QuadPart == 0) {
+		return nullptr;
+	}
+	file->size = static_cast<size_t>(filesize.QuadPart);
+	file->mappinghandle = CreateFileMappingA(handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (!file->mappinghandle) {
+		return nullptr;
+	}
+	file->data = static_cast<unsigned char*>(MapViewOfFile(file->mappinghandle, FILE_MAP_COPY, 0, 0, 0));
+	if (!file->data) {
+		return nullptr;
+	}
+#else
+	int descriptor = ::open(fullpath.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		return nullptr;
+	}
+	struct stat status{};
+	if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+		close(descriptor);
+		return nullptr;
+	}
+	size_t size = static_cast<size_t>(status.st_size);
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+	// The mapping stays valid after the descriptor is closed
+	close(descriptor);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+	file->data = static_cast<unsigned char*>(data);
+	file->size = size;
+#endif
+	return file;
+}
+
+}
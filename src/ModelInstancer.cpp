@@ -0,0 +1,202 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/ModelInstancer.h"
+
+#include "gRenderObject.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace gecs {
+
+// GLES targets need the es profile and a default precision, like the engine's own shaders
+#if defined(GLIST_MOBILE) || defined(GLIST_WEB)
+#define GECS_GLSL_HEADER "#version 300 es\nprecision mediump float;\n"
+#else
+#define GECS_GLSL_HEADER "#version 330 core\n"
+#endif
+
+static const char* vertexshader = GECS_GLSL_HEADER R"(
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in mat4 aInstance;
+uniform mat4 viewprojection;
+uniform mat4 meshmatrix;
+out vec2 TexCoords;
+void main() {
+	TexCoords = aTexCoords;
+	gl_Position = viewprojection * aInstance * meshmatrix * vec4(aPosition, 1.0);
+}
+)";
+
+static const char* fragmentshader = GECS_GLSL_HEADER R"(
+in vec2 TexCoords;
+uniform sampler2D diffusemap;
+uniform int hasdiffusemap;
+uniform vec4 diffusecolor;
+uniform vec4 ambient;
+out vec4 FragColor;
+void main() {
+	vec4 color = diffusecolor;
+	if (hasdiffusemap != 0) {
+		color *= texture(diffusemap, TexCoords);
+	}
+	FragColor = vec4(color.rgb * ambient.rgb, color.a);
+}
+)";
+
+ModelInstancer::~ModelInstancer() {
+	for (ModelBuffers& buffers : models) {
+		deleteBuffers(buffers);
+	}
+	if (instancevbo) {
+		glDeleteBuffers(1, &instancevbo);
+	}
+}
+
+bool ModelInstancer::canInstance(gModel& model) {
+	return !model.isAnimated();
+}
+
+void ModelInstancer::draw(const std::shared_ptr<gModel>& model, const std::vector<glm::mat4>& matrices, const glm::vec4& ambient) {
+	if (matrices.empty()) {
+		return;
+	}
+	if (!shader) {
+		setup();
+	}
+
+	// Whatever the renderer had bound is put back once the copies are drawn
+	GLint previousprogram = 0;
+	GLint previousvertexarray = 0;
+	GLint previousarraybuffer = 0;
+	GLint previousactivetexture = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousprogram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousvertexarray);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousarraybuffer);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &previousactivetexture);
+
+	ModelBuffers& buffers = getBuffers(model);
+	glBindBuffer(GL_ARRAY_BUFFER, instancevbo);
+	size_t bytes = matrices.size() * sizeof(glm::mat4);
+	if (bytes > instancecapacity) {
+		instancecapacity = std::max(bytes, instancecapacity * 2);
+	}
+	// Orphan the old storage so the driver doesn't wait on the previous run
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instancecapacity), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes), matrices.data());
+
+	gRenderer* renderer = gRenderObject::getRenderer();
+	shader->use();
+	shader->setMat4("viewprojection", renderer->getProjectionMatrix() * renderer->getViewMatrix());
+	shader->setInt("diffusemap", 0);
+	shader->setVec4("ambient", ambient);
+	glActiveTexture(GL_TEXTURE0);
+	for (MeshBuffers& mesh : buffers.meshes) {
+		gMaterial* material = mesh.mesh->getMaterial();
+		const gColor* color = material->getDiffuseColor();
+		gTexture* texture = material->isDiffuseMapEnabled() ? material->getDiffuseMap() : nullptr;
+		shader->setMat4("meshmatrix", mesh.matrix);
+		shader->setVec4("diffusecolor", glm::vec4(color->r, color->g, color->b, color->a));
+		shader->setInt("hasdiffusemap", texture != nullptr);
+		if (texture) {
+			texture->bind();
+		}
+		glBindVertexArray(mesh.vao);
+		if (mesh.ebo) {
+			glDrawElementsInstanced(GL_TRIANGLES, mesh.count, sizeof(gIndex) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr,
+									static_cast<GLsizei>(matrices.size()));
+		} else {
+			glDrawArraysInstanced(GL_TRIANGLES, 0, mesh.count, static_cast<GLsizei>(matrices.size()));
+		}
+		if (texture) {
+			texture->unbind();
+		}
+		drawcalls++;
+	}
+
+	glBindVertexArray(static_cast<GLuint>(previousvertexarray));
+	glUseProgram(static_cast<GLuint>(previousprogram));
+	glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(previousarraybuffer));
+	glActiveTexture(static_cast<GLenum>(previousactivetexture));
+}
+
+void ModelInstancer::releaseUnused() {
+	drawcalls = 0;
+	for (size_t i = 0; i < models.size();) {
+		if (models[i].model.expired()) {
+			deleteBuffers(models[i]);
+			models[i] = std::move(models.back());
+			models.pop_back();
+		} else {
+			i++;
+		}
+	}
+}
+
+void ModelInstancer::setup() {
+	shader = std::make_unique<gShader>();
+	shader->loadProgram(vertexshader, fragmentshader);
+	glGenBuffers(1, &instancevbo);
+}
+
+ModelInstancer::ModelBuffers& ModelInstancer::getBuffers(const std::shared_ptr<gModel>& model) {
+	for (ModelBuffers& buffers : models) {
+		if (buffers.model.lock() == model) {
+			return buffers;
+		}
+	}
+	ModelBuffers& buffers = models.emplace_back();
+	buffers.model = model;
+	buffers.meshes.resize(model->getMeshNum());
+	for (int i = 0; i < model->getMeshNum(); i++) {
+		createMesh(*model, model->getMesh(i), buffers.meshes[i]);
+	}
+	return buffers;
+}
+
+void ModelInstancer::createMesh(gModel& model, gMesh* mesh, MeshBuffers& buffers) {
+	const std::vector<gVertex>& vertices = mesh->getVertices();
+	const std::vector<gIndex>& indices = mesh->getIndices();
+	buffers.mesh = mesh;
+	// Instances carry the model's world matrix, meshes keep their offset within it
+	buffers.matrix = glm::inverse(model.getTransformationMatrix()) * mesh->getTransformationMatrix();
+	buffers.count = static_cast<int>(indices.empty() ? vertices.size() : indices.size());
+	glGenVertexArrays(1, &buffers.vao);
+	glGenBuffers(1, &buffers.vbo);
+	glBindVertexArray(buffers.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vbo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(gVertex)), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(gVertex), reinterpret_cast<const void*>(offsetof(gVertex, position)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(gVertex), reinterpret_cast<const void*>(offsetof(gVertex, texcoords)));
+	if (!indices.empty()) {
+		glGenBuffers(1, &buffers.ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(gIndex)), indices.data(), GL_STATIC_DRAW);
+	}
+	// A mat4 attribute takes four vec4 slots, advanced once per instance
+	glBindBuffer(GL_ARRAY_BUFFER, instancevbo);
+	for (GLuint column = 0; column < 4; column++) {
+		glEnableVertexAttribArray(2 + column);
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<const void*>(column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(2 + column, 1);
+	}
+	glBindVertexArray(0);
+}
+
+void ModelInstancer::deleteBuffers(ModelBuffers& buffers) {
+	for (MeshBuffers& mesh : buffers.meshes) {
+		glDeleteVertexArrays(1, &mesh.vao);
+		glDeleteBuffers(1, &mesh.vbo);
+		if (mesh.ebo) {
+			glDeleteBuffers(1, &mesh.ebo);
+		}
+	}
+	buffers.meshes.clear();
+}
+
+}
@@ -0,0 +1,20 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/Prefab.h"
+
+namespace gecs {
+
+Prefab Prefab::fromEntity(Entity entity) {
+	Prefab prefab;
+	prefab.name = entity.getName();
+	prefab.transform = entity.getComponent<TransformComponent>();
+	prefab.capture<SpriteComponent>(entity);
+	prefab.capture<ModelComponent>(entity);
+	prefab.capture<LightAmbientComponent>(entity);
+	prefab.capture<BehaviorsComponent>(entity);
+	return prefab;
+}
+
+}
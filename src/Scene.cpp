@@ -6,9 +6,20 @@
 #include "ecs/InputManager.h"
 #include "ecs/Behavior.h"
 #include "ecs/Entity.h"
+#include "ecs/Prefab.h"
 
 namespace gecs {
 
+static constexpr uint32_t HIERARCHY_NONE = std::numeric_limits<uint32_t>::max();
+static constexpr uint32_t MODEL_NONE = std::numeric_limits<uint32_t>::max();
+// Set in the payload of draws queued through submitDraw
+static constexpr uint32_t DRAW_CUSTOM = uint32_t(1) << 31;
+
+// Sprites turn around the x axis, in degrees
+static float getSpriteAngle(const TransformComponent& transform) {
+	return glm::degrees(glm::pitch(transform.getOrientation()));
+}
+
 SceneCanvas::SceneCanvas(gBaseApp* app) : gBaseCanvas(app) {
 	scene = std::make_unique<Scene>();
 	InputManager::init();
@@ -24,6 +35,7 @@ void SceneCanvas::update() {
 	deltatime = appmanager->getElapsedTime();
 	if (scene) {
 		scene->update(deltatime);
+		scene->flushCommandBuffers();
 		scene->processDestroyQueue();
 	}
 }
@@ -41,13 +53,28 @@ void SceneCanvas::onEvent(gEvent& event) {
 }
 
 Scene::Scene() {
-	bindSystem<Entity, BehaviorsComponent>(SystemType::UPDATE, G_BIND_FUNCTION(updateBehaviors));
-	bindSystem<Entity, TransformComponent, CameraComponent>(SystemType::UPDATE, G_BIND_FUNCTION(updateCamera));
-	bindSystem<Entity, TransformComponent, LightAmbientComponent>(SystemType::UPDATE, G_BIND_FUNCTION(updateLight));
-	bindSystem<Entity, TransformComponent, ModelComponent>(SystemType::UPDATE, G_BIND_FUNCTION(updateModel));
-	bindSystem<Entity, TransformComponent>(SystemType::UPDATE, G_BIND_FUNCTION(updateTransform));
-	bindSystem<Entity, TransformComponent, ModelComponent>(SystemType::DRAW3D, G_BIND_FUNCTION(renderModel));
-	bindSystem<Entity, TransformComponent, SpriteComponent>(SystemType::DRAW2D, G_BIND_FUNCTION(renderSprite));
+	size_t threadcount = ThreadPool::getShared().getWorkerCount() + 1;
+	for (size_t i = 0; i < threadcount; i++) {
+		commandbuffers.push_back(std::make_unique<CommandBuffer>(this));
+	}
+	// Behaviors can touch any component and lights register with the renderer
+	bindPipeline<Entity, StaticSystem<&Scene::updateBehaviors, BehaviorsComponent>>(SystemType::UPDATE, SystemAccess::exclusive(), this);
+	bindPipeline<Entity, StaticSystem<&Scene::updateLight, TransformComponent, LightAmbientComponent>>(SystemType::UPDATE, SystemAccess::exclusive(), this);
+	bindSystem<Entity, const TransformComponent, const WorldMatrixComponent, CameraComponent>(SystemType::LATEUPDATE, Changed<TransformComponent>{},
+		[this](float deltatime, Entity entity, const TransformComponent& transform, const WorldMatrixComponent& world, CameraComponent& camera) {
+			updateCamera(deltatime, entity, transform, world, camera);
+		});
+	registry.storage<ModelComponent>();
+	getSystems(SystemType::DRAW3D).add(makeSystemAccess<const WorldMatrixComponent, const ModelComponent>(), [this](float deltatime) {
+		renderModels(deltatime);
+	});
+	registry.storage<TransformComponent>();
+	registry.storage<WorldMatrixComponent>();
+	registry.storage<NormalMatrixComponent>();
+	registry.storage<SpriteComponent>();
+	getSystems(SystemType::DRAW2D).add(makeSystemAccess<const TransformComponent, const SpriteComponent>(), [this](float deltatime) {
+		renderSprites(deltatime);
+	});
 }
 
 Scene::~Scene() {
@@ -59,22 +86,119 @@ Entity Scene::createEntity(const std::string& name) {
 }
 
 Entity Scene::createEntityWithUUID(gUUID uuid, const std::string& name) {
-	Entity entity = {registry.create(), this};
-	entity.addComponent<IdComponent>(uuid);
-	entity.addComponent<TransformComponent>();
-	entity.addComponent<TagComponent>(name.empty() ? "Entity" : name);
+	if (isDeferring()) [[unlikely]] {
+		return {getCommandBuffer().createEntityWithUUID(uuid, name), this};
+	}
+	entt::entity handle = registry.create();
+	setupEntity(handle, uuid, name);
+	return {handle, this};
+}
+
+void Scene::setupEntity(entt::entity handle, gUUID uuid, const std::string& name) {
+	addComponent<IdComponent>(handle, uuid);
+	addComponent<TransformComponent>(handle);
+	addComponent<TagComponent>(handle, name.empty() ? "Entity" : name);
 
-	entities[uuid] = entity;
-	scenehierarchy.push_back(entity);
-	return entity;
+	entities[uuid] = handle;
+	uint32_t id = entt::to_entity(handle);
+	if (hierarchyslots.size() <= id) {
+		hierarchyslots.resize(id + 1, HIERARCHY_NONE);
+	}
+	hierarchyslots[id] = static_cast<uint32_t>(scenehierarchy.size());
+	scenehierarchy.push_back(handle);
+}
+
+std::vector<entt::entity> Scene::createEntities(size_t count, const std::string& name, const TransformComponent& prototype) {
+	std::vector<entt::entity> handles(count);
+	if (isDeferring()) [[unlikely]] {
+		CommandBuffer& buffer = getCommandBuffer();
+		for (entt::entity& handle : handles) {
+			handle = buffer.createEntity(name);
+			buffer.addComponent<TransformComponent>(handle, prototype);
+		}
+		return handles;
+	}
+	registry.create(handles.begin(), handles.end());
+	std::vector<IdComponent> ids;
+	ids.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		ids.emplace_back(gUUID());
+	}
+	TransformComponent transform = prototype;
+	registry.insert<IdComponent>(handles.begin(), handles.end(), ids.begin());
+	registry.insert<TransformComponent>(handles.begin(), handles.end(), transform);
+	registry.insert<WorldMatrixComponent>(handles.begin(), handles.end());
+	registry.insert<NormalMatrixComponent>(handles.begin(), handles.end());
+	registry.insert<TagComponent>(handles.begin(), handles.end(), TagComponent(name.empty() ? "Entity" : name));
+
+	entities.reserve(entities.size() + count);
+	scenehierarchy.reserve(scenehierarchy.size() + count);
+	for (size_t i = 0; i < count; i++) {
+		entt::entity handle = handles[i];
+		tagindex.insert(handle, registry.get<TagComponent>(handle));
+		trackTransform(handle, registry.get<TransformComponent>(handle));
+		entities[ids[i].id] = handle;
+		uint32_t id = entt::to_entity(handle);
+		if (hierarchyslots.size() <= id) {
+			hierarchyslots.resize(id + 1, HIERARCHY_NONE);
+		}
+		hierarchyslots[id] = static_cast<uint32_t>(scenehierarchy.size());
+		scenehierarchy.push_back(handle);
+	}
+	return handles;
+}
+
+std::vector<entt::entity> Scene::instantiate(const Prefab& prefab, size_t count) {
+	std::vector<entt::entity> handles = createEntities(count, prefab.name, prefab.transform);
+	for (auto& [type, slot] : prefab.components) {
+		slot->insertInto(*this, handles);
+	}
+	return handles;
 }
 
 void Scene::removeEntity(Entity entity) {
-	entities.erase(entity.getUUID());
-	destroyqueue.push_back(entity.getHandle());
-	scenehierarchy.erase(std::remove_if(scenehierarchy.begin(), scenehierarchy.end(), [&](auto& e) {
-  return e == entity;
-}));
+	removeHandle(entity.getHandle());
+	if (hierarchyholes * 2 > scenehierarchy.size()) {
+		compactHierarchy();
+	}
+}
+
+void Scene::removeHandle(entt::entity handle) {
+	if (isDeferring()) {
+		getCommandBuffer().removeEntity(handle);
+		return;
+	}
+	// A stale handle would hit the entity now living in its slot
+	if (!registry.valid(handle)) {
+		return;
+	}
+	uint32_t id = entt::to_entity(handle);
+	if (id >= hierarchyslots.size() || hierarchyslots[id] == HIERARCHY_NONE) {
+		return; // already removed
+	}
+	entities.erase(registry.get<IdComponent>(handle).id);
+	destroyqueue.push_back(handle);
+	scenehierarchy[hierarchyslots[id]] = entt::null;
+	hierarchyslots[id] = HIERARCHY_NONE;
+	hierarchyholes++;
+}
+
+const std::vector<entt::entity>& Scene::getSceneHierarchy() {
+	if (hierarchyholes > 0) {
+		compactHierarchy();
+	}
+	return scenehierarchy;
+}
+
+const std::vector<entt::entity>* Scene::getChildHandles(entt::entity handle) {
+	auto* tree = registry.try_get<TreeComponent>(handle);
+	if (!tree) {
+		return nullptr;
+	}
+	if (tree->holes > 0) {
+		compactChildren(*tree);
+	}
+	return &tree->childs;
 }
 
 void Scene::onUpdate(float_t deltatime) {
@@ -100,14 +224,74 @@ void Scene::onRemoveComponent(entt::entity entity, LightAmbientComponent& compon
 
 template<>
 void Scene::onAddComponent(entt::entity entity, CameraComponent& component) {
-	component.fbo.allocate(renderer->getScreenWidth(), renderer->getScreenHeight());
+	component.allocate(renderer->getScreenWidth(), renderer->getScreenHeight());
+	// The camera picks up its transform the next time it changes
+	if (auto* transform = registry.try_get<TransformComponent>(entity)) {
+		transform->markChanged();
+	}
 }
 
 template<>
 void Scene::onAddComponent(entt::entity entity, TransformComponent& component) {
+	trackTransform(entity, component);
+	registry.emplace_or_replace<WorldMatrixComponent>(entity);
+	registry.emplace_or_replace<NormalMatrixComponent>(entity);
 	updateMatrices(entity);
 }
 
+template<>
+void Scene::onRemoveComponent(entt::entity entity, TransformComponent& component) {
+	registry.remove<WorldMatrixComponent, NormalMatrixComponent>(entity);
+}
+
+template<>
+void Scene::onAddComponent(entt::entity entity, ModelComponent& component) {
+	component.link = ChangeLink(&modelchanges, entity);
+	component.isboundschanged = false;
+	component.markBoundsChanged();
+}
+
+template<>
+void Scene::onRemoveComponent(entt::entity entity, ModelComponent& component) {
+	// Still attached here, so bound the entity by its position directly
+	if (auto* world = registry.try_get<WorldMatrixComponent>(entity)) {
+		glm::vec3 position(world->matrix[3]);
+		spatialindex.update(entity, {position, position});
+	}
+}
+
+template<>
+void Scene::onAddComponent(entt::entity entity, TagComponent& component) {
+	tagindex.insert(entity, component);
+}
+
+template<>
+void Scene::onRemoveComponent(entt::entity entity, TagComponent& component) {
+	tagindex.erase(component);
+}
+
+template<>
+void Scene::replaceComponent(entt::entity handle, IdComponent& component) {
+	IdComponent& id = registry.get<IdComponent>(handle);
+	entities.erase(id.id);
+	id.id = component.id;
+	entities[id.id] = handle;
+}
+
+template<>
+void Scene::replaceComponent(entt::entity handle, TagComponent& component) {
+	// Goes through setTag so the tag index follows the rename
+	registry.get<TagComponent>(handle).setTag(component.getTag());
+}
+
+template<>
+void Scene::replaceComponent(entt::entity handle, ModelComponent& component) {
+	ModelComponent& model = registry.get<ModelComponent>(handle);
+	model = std::move(component);
+	// The move handed over the detached link of the recorded copy
+	onAddComponent(handle, model);
+}
+
 void Scene::linkEntities(entt::entity parent, entt::entity child) {
 	entt::entity loop_entity = parent;
 	while (loop_entity != entt::null) {
@@ -120,47 +304,56 @@ void Scene::linkEntities(entt::entity parent, entt::entity child) {
 		auto& tree = registry.get_or_emplace<TreeComponent>(loop_entity);
 		loop_entity = tree.parent;
 	}
-	auto& parent_tree = registry.get_or_emplace<TreeComponent>(parent);
-	auto& child_tree = registry.get_or_emplace<TreeComponent>(child);
-	if (child_tree.parent != entt::null) {
-		unlinkEntities(child_tree.parent, child);
+	// Emplace both before taking references, emplacing may move the storage
+	registry.get_or_emplace<TreeComponent>(parent);
+	registry.get_or_emplace<TreeComponent>(child);
+	if (entt::entity oldparent = registry.get<TreeComponent>(child).parent; oldparent != entt::null) {
+		unlinkEntities(oldparent, child);
 	}
+	auto& parent_tree = registry.get<TreeComponent>(parent);
+	auto& child_tree = registry.get<TreeComponent>(child);
+	child_tree.slot = static_cast<uint32_t>(parent_tree.childs.size());
 	parent_tree.childs.push_back(child);
 	child_tree.parent = parent;
 	auto& child_transform = registry.get<TransformComponent>(child);
 	auto& parent_transform = registry.get<TransformComponent>(parent);
 	glm::vec3 posDiff = child_transform.position - parent_transform.position;
-	glm::vec3 rotDiff = child_transform.rotation - parent_transform.rotation;
+	glm::quat rotDiff = glm::inverse(parent_transform.rotation) * child_transform.rotation;
 
 	child_transform.position = posDiff;
 	child_transform.rotation = rotDiff;
-	child_transform.ischanged = true;
+	child_transform.markChanged();
 }
 
 void Scene::unlinkEntities(entt::entity parent, entt::entity child) {
-	auto& parent_tree = registry.get_or_emplace<TreeComponent>(parent);
-	auto& child_tree = registry.get_or_emplace<TreeComponent>(child);
-	if (child_tree.parent == entt::null) {
+	auto* parent_tree = registry.try_get<TreeComponent>(parent);
+	auto* child_tree = registry.try_get<TreeComponent>(child);
+	if (!parent_tree || !child_tree || child_tree->parent != parent) {
 		return;
 	}
-	parent_tree.childs.erase(
-	 std::remove(parent_tree.childs.begin(), parent_tree.childs.end(), child),
-	 parent_tree.childs.end());
-	child_tree.parent = entt::null;
+	eraseChild(*parent_tree, *child_tree);
+	applyParentTransform(parent, child);
+}
+
+void Scene::applyParentTransform(entt::entity parent, entt::entity child) {
 	auto& child_transform = registry.get<TransformComponent>(child);
 	auto& parent_transform = registry.get<TransformComponent>(parent);
 	glm::vec3 pos_diff = child_transform.position + parent_transform.position;
-	glm::vec3 rot_diff = child_transform.rotation + parent_transform.rotation;
+	glm::quat rot_diff = parent_transform.rotation * child_transform.rotation;
 
 	child_transform.position = pos_diff;
 	child_transform.rotation = rot_diff;
-	child_transform.ischanged = true;
+	child_transform.markChanged();
 }
 
 void Scene::processDestroyQueue() {
-	for (const auto& item : destroyqueue) {
-		destroyEntity(item);
+	if (destroyqueue.empty()) {
+		return;
 	}
+	for (entt::entity handle : destroyqueue) {
+		detachEntity(handle);
+	}
+	registry.destroy(destroyqueue.begin(), destroyqueue.end());
 	destroyqueue.clear();
 }
 
@@ -171,50 +364,48 @@ void Scene::update(float deltatime) {
 		}*/
 		firstupdate = false;
 	}
-	for (auto&& fn : systems[SystemType::UPDATE]) {
-		fn(deltatime);
-	}
+	rebuildSpriteGrid();
+	ThreadPool* pool = isparallelupdate ? &ThreadPool::getShared() : nullptr;
+	runSystems(SystemType::UPDATE, pool, deltatime);
+	propagateTransforms();
+	runSystems(SystemType::LATEUPDATE, pool, deltatime);
 }
 
 void Scene::draw(float deltatime) {
-	const auto it = registry.view<CameraComponent, TransformComponent>();
-	// Render to each camera
-	for (entt::entity handle : it) {
-		CameraComponent& component = it.get<CameraComponent>(handle);
-		if (!component.isenabled) {
-			continue;
-		}
-		TransformComponent& transform = it.get<TransformComponent>(handle);
+	modelinstancer.releaseUnused();
+	prepareModels();
+	prepareViews();
+	for (RenderView& view : renderviews) {
+		currentview = &view;
+		CameraComponent& component = registry.get<CameraComponent>(view.camera);
+		const TransformComponent& transform = registry.get<TransformComponent>(view.camera);
+		const glm::mat4& matrix = registry.get<WorldMatrixComponent>(view.camera).matrix;
 		component.fbo.bind();
 		renderer->enableDepthTest();
 		renderer->clearColor(0.0f, 0.0f, 0.0f, 0.0f);
-		component.begin(transform.position, transform.transformmatrix);
+		component.begin(transform.position, matrix);
 		if (hasskybox) {
 			skybox.draw();
 		}
-		for (auto&& fn : systems[SystemType::DRAW3D]) {
-			fn(deltatime);
-		}
+		drawposition = transform.position;
+		drawfarplane = component.farplane;
+		runSystems(SystemType::DRAW3D, nullptr, deltatime);
+		executeDrawList();
+		runSystems(SystemType::LATEDRAW3D, nullptr, deltatime);
 		component.end();
 		renderer->disableDepthTest();
 		component.fbo.unbind();
 	}
+	currentview = nullptr;
 	renderpassno = renderpassnum - 1;
 
 	// Render to screen
 	renderer->bindDefaultFramebuffer();
 	renderer->clearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	for (entt::entity handle : it) {
-		CameraComponent& component = it.get<CameraComponent>(handle);
-		if (!component.isenabled) {
-			continue;
-		}
-		component.fbo.draw(0, 0, renderer->getWidth(), renderer->getHeight());
-		break;
-	}
-	for (auto&& fn : systems[SystemType::DRAW2D]) {
-		fn(deltatime);
+	if (registry.valid(screencamera)) {
+		registry.get<CameraComponent>(screencamera).fbo.draw(0, 0, renderer->getWidth(), renderer->getHeight());
 	}
+	runSystems(SystemType::DRAW2D, nullptr, deltatime);
 }
 
 void Scene::setSkybox(std::shared_ptr<AssetBase> asset) {
@@ -229,69 +420,305 @@ bool Scene::onWindowResizeEvent(gWindowResizeEvent& event) {
 	return false;
 }
 
-glm::mat4 Scene::makeLocal(const TransformComponent& t) {
-	glm::vec3 rotRad = glm::radians(t.rotation);
-	glm::mat4 R = glm::toMat4(glm::quat(rotRad));
-	glm::mat4 T = glm::translate(glm::mat4(1.0f), t.position);
-	glm::mat4 Tp = glm::translate(glm::mat4(1.0f), t.pivot);
-	glm::mat4 Tn = glm::translate(glm::mat4(1.0f), -t.pivot);
-	glm::mat4 S = glm::scale(glm::mat4(1.0f), t.scale);
+void Scene::trackTransform(entt::entity handle, TransformComponent& transform) {
+	transform.link = ChangeLink(&transformchanges, handle);
+	transform.ischanged = true;
+	transformchanges.mark(handle);
+}
 
-	// move to Position, shift to Pivot, rotate+scale, shift back
-	return T * Tp * R * S * Tn;
+glm::mat4 Scene::makeLocal(const TransformComponent& t) {
+	glm::mat3 rs = glm::mat3_cast(t.rotation);
+	rs[0] *= t.scale.x;
+	rs[1] *= t.scale.y;
+	rs[2] *= t.scale.z;
+	// Same as moving to position, shifting to pivot, rotating and scaling
+	// and shifting back, without the matrix products
+	glm::mat4 local(rs);
+	local[3] = glm::vec4(t.position + t.pivot - rs * t.pivot, 1.0f);
+	return local;
 }
 
-glm::mat4 Scene::getWorldMatrix(entt::entity entity) {
-	auto& transform = registry.get<TransformComponent>(entity);
-	glm::mat4 local = makeLocal(transform);
+glm::mat3 Scene::makeLocalNormal(const TransformComponent& t) {
+	// inverseTranspose(R * S) is R * S^-1
+	glm::mat3 normal = glm::mat3_cast(t.rotation);
+	normal[0] /= t.scale.x;
+	normal[1] /= t.scale.y;
+	normal[2] /= t.scale.z;
+	return normal;
+}
 
+void Scene::updateMatrices(entt::entity entity) {
+	auto& tc = registry.get<TransformComponent>(entity);
+	glm::mat4& world = registry.get<WorldMatrixComponent>(entity).matrix;
+	glm::mat3& normal = registry.get<NormalMatrixComponent>(entity).matrix;
+	world = makeLocal(tc);
+	normal = makeLocalNormal(tc);
 	if (auto* tree = registry.try_get<TreeComponent>(entity);
 		tree && tree->parent != entt::null) {
-		return getWorldMatrix(tree->parent) * local;
+		// Parents are always propagated before their children, reuse the cached matrices
+		world = registry.get<WorldMatrixComponent>(tree->parent).matrix * world;
+		normal = registry.get<NormalMatrixComponent>(tree->parent).matrix * normal;
+	}
+}
+
+void Scene::propagateTransforms() {
+	// Only entities whose TransformComponent reported a change are visited
+	for (entt::entity handle : worldchanged) {
+		if (registry.valid(handle)) {
+			if (auto* transform = registry.try_get<TransformComponent>(handle)) {
+				transform->isworldchanged = false;
+			}
 		}
-	return local;
+	}
+	worldchanged.clear();
+	transformchanges.collect(changedtransforms);
+	transformkernel.clear();
+	dirtyroots.clear();
+	nestedchanges.clear();
+	auto view = registry.view<TransformComponent>();
+	for (entt::entity handle : changedtransforms) {
+		if (!registry.valid(handle) || !view.contains(handle)) {
+			continue;
+		}
+		auto& transform = view.get<TransformComponent>(handle);
+		if (!transform.ischanged) {
+			continue; // listed twice
+		}
+		if (auto* tree = registry.try_get<TreeComponent>(handle); tree && tree->parent != entt::null) {
+			nestedchanges.push_back(handle);
+			continue;
+		}
+		// Changed roots are computed in bulk, their children one by one below
+		transformkernel.add(transform.position, transform.rotation, transform.scale, transform.pivot);
+		dirtyroots.push_back(handle);
+		transform.ischanged = false;
+	}
+	transformkernel.compute();
+	// Pushed first so subtrees of changed roots are done first. A nested
+	// entity whose ancestor changes later in the pass is computed twice, the
+	// second time with the right parent.
+	for (entt::entity handle : nestedchanges) {
+		propagationstack.emplace_back(handle, false);
+	}
+	auto worlds = registry.view<WorldMatrixComponent, NormalMatrixComponent>();
+	for (size_t i = 0; i < dirtyroots.size(); i++) {
+		entt::entity handle = dirtyroots[i];
+		glm::mat4& world = worlds.get<WorldMatrixComponent>(handle).matrix;
+		transformkernel.getMatrices(i, world, worlds.get<NormalMatrixComponent>(handle).matrix);
+		view.get<TransformComponent>(handle).isworldchanged = true;
+		worldchanged.push_back(handle);
+		spatialindex.update(handle, computeBounds(handle, world));
+		if (auto* tree = registry.try_get<TreeComponent>(handle)) {
+			for (entt::entity child : tree->childs) {
+				if (child != entt::null) {
+					propagationstack.emplace_back(child, true);
+				}
+			}
+		}
+	}
+	while (!propagationstack.empty()) {
+		auto [handle, parentchanged] = propagationstack.back();
+		propagationstack.pop_back();
+		auto& transform = view.get<TransformComponent>(handle);
+		if (!parentchanged && !transform.ischanged) {
+			continue;
+		}
+		updateMatrices(handle);
+		spatialindex.update(handle, computeBounds(handle, worlds.get<WorldMatrixComponent>(handle).matrix));
+		transform.ischanged = false;
+		if (!transform.isworldchanged) {
+			transform.isworldchanged = true;
+			worldchanged.push_back(handle);
+		}
+		if (auto* tree = registry.try_get<TreeComponent>(handle)) {
+			for (entt::entity child : tree->childs) {
+				if (child != entt::null) {
+					propagationstack.emplace_back(child, true);
+				}
+			}
+		}
+	}
+
+	// Models added or loaded on entities that didn't move
+	modelchanges.collect(changedmodels);
+	for (entt::entity handle : changedmodels) {
+		if (!registry.valid(handle)) {
+			continue;
+		}
+		auto* model = registry.try_get<ModelComponent>(handle);
+		if (!model || !model->isboundschanged) {
+			continue;
+		}
+		model->isboundschanged = false;
+		if (auto* world = registry.try_get<WorldMatrixComponent>(handle)) {
+			spatialindex.update(handle, computeBounds(handle, world->matrix));
+		}
+	}
 }
 
-void Scene::updateMatrices(entt::entity entity) {
-	auto& tc = registry.get<TransformComponent>(entity);
-	tc.transformmatrix = getWorldMatrix(entity);
-	tc.normalmatrix = glm::inverseTranspose(glm::mat3(tc.transformmatrix));
+void Scene::rebuildSpriteGrid() {
+	spritegrid.clear();
+	auto view = registry.view<TransformComponent, SpriteComponent>();
+	for (entt::entity handle : view) {
+		const TransformComponent& transform = view.get<TransformComponent>(handle);
+		const SpriteComponent& sprite = view.get<SpriteComponent>(handle);
+		if (!sprite.data) {
+			continue;
+		}
+		glm::vec2 size = sprite.region.isValid()
+			? glm::vec2(sprite.region.width, sprite.region.height)
+			: glm::vec2(sprite.data->getWidth(), sprite.data->getHeight());
+		size *= glm::vec2(transform.scale);
+		// Matches where renderSprite puts the sprite
+		glm::vec2 min(transform.position.x + transform.pivot.x, transform.position.y - transform.pivot.y);
+		spritegrid.add(handle, min, min + size);
+	}
+	spritegrid.build();
 }
 
-void Scene::destroyEntity(entt::entity handle) {
-	registry.destroy(handle);
+Aabb Scene::computeBounds(entt::entity handle, const glm::mat4& matrix) {
+	auto* model = registry.try_get<ModelComponent>(handle);
+	if (!model || model->bounds.w < 0.0f) {
+		glm::vec3 position(matrix[3]);
+		return {position, position};
+	}
+	float scale = std::max({glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))});
+	glm::vec3 center(matrix * glm::vec4(glm::vec3(model->bounds), 1.0f));
+	glm::vec3 extent(model->bounds.w * scale);
+	return {center - extent, center + extent};
+}
+
+void Scene::eraseChild(TreeComponent& parenttree, TreeComponent& childtree) {
+	parenttree.childs[childtree.slot] = entt::null;
+	parenttree.holes++;
+	childtree.parent = entt::null;
+	if (parenttree.holes * 2 > parenttree.childs.size()) {
+		compactChildren(parenttree);
+	}
 }
 
-void Scene::updateTransform(float deltatime, Entity entity, TransformComponent& transform) {
-	if (transform.ischanged) {
-		updateMatrices(entity.getHandle());
-		transform.ischanged = false;
+void Scene::compactChildren(TreeComponent& tree) {
+	uint32_t count = 0;
+	for (entt::entity child : tree.childs) {
+		if (child == entt::null) {
+			continue;
+		}
+		registry.get<TreeComponent>(child).slot = count;
+		tree.childs[count++] = child;
 	}
+	tree.childs.resize(count);
+	tree.holes = 0;
 }
 
-void Scene::updateCamera(float deltatime, Entity entity, TransformComponent& transform, CameraComponent& camera) {
-	if (transform.ischanged) {
-		updateMatrices(entity.getHandle());
-		camera.data.setComponentsUnsafe(transform.position, transform.rotation, transform.scale, transform.transformmatrix);
-		transform.ischanged = false;
+void Scene::compactHierarchy() {
+	uint32_t count = 0;
+	for (entt::entity handle : scenehierarchy) {
+		if (handle == entt::null) {
+			continue;
+		}
+		hierarchyslots[entt::to_entity(handle)] = count;
+		scenehierarchy[count++] = handle;
 	}
+	scenehierarchy.resize(count);
+	hierarchyholes = 0;
 }
 
-void Scene::updateModel(float deltatime, Entity entity, TransformComponent& transform, ModelComponent& model) {
-	if (transform.ischanged) {
-		updateMatrices(entity.getHandle());
-		model.data.setPosition(transform.position);
-		glm::quat orientation = glm::quatLookAt(glm::vec3(0.0f, 0.0f, -1.0f),
-			glm::vec3(0.0f, 1.0f, 0.0f)) *
-				glm::angleAxis(transform.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f)) *
-					glm::angleAxis(transform.rotation.z, glm::vec3(0.0f, 0.0f, 1.0f)) *
-						glm::angleAxis(transform.rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-		model.data.setOrientation(orientation);
-		model.data.setTransformationMatrix(transform.transformmatrix);
-		transform.ischanged = false;
+void Scene::detachEntity(entt::entity handle) {
+	if (auto* tree = registry.try_get<TreeComponent>(handle)) {
+		if (tree->parent != entt::null) {
+			eraseChild(registry.get<TreeComponent>(tree->parent), *tree);
+		}
+		// Children become roots and keep their place, like unlinkEntities
+		for (entt::entity child : tree->childs) {
+			if (child == entt::null) {
+				continue;
+			}
+			registry.get<TreeComponent>(child).parent = entt::null;
+			applyParentTransform(handle, child);
+		}
+	}
+	if (auto* tag = registry.try_get<TagComponent>(handle)) {
+		tagindex.erase(*tag);
+	}
+	spatialindex.remove(handle);
+}
+
+void Scene::runSystems(SystemType type, ThreadPool* pool, float deltatime) {
+	// Systems of a wave may run side by side, so none of them changes the
+	// registry until the phase is over
+	refillHandles();
+	isdeferringphase = pool != nullptr;
+	getSystems(type).run(deltatime, pool);
+	isdeferringphase = false;
+	flushCommandBuffers();
+}
+
+void Scene::refillHandles() {
+	for (auto& buffer : commandbuffers) {
+		size_t target = std::max(deferredreserve, buffer->requestedhandles * 2);
+		buffer->requestedhandles = 0;
+		buffer->isreserveempty = false;
+		std::vector<entt::entity>& handles = buffer->reservedhandles;
+		if (handles.size() < target) {
+			size_t first = handles.size();
+			handles.resize(target);
+			registry.create(handles.begin() + first, handles.end());
+		}
 	}
 }
 
+void Scene::flushCommandBuffers() {
+	bool isempty = true;
+	for (auto& buffer : commandbuffers) {
+		isempty = isempty && buffer->isEmpty();
+	}
+	if (isempty) {
+		return;
+	}
+	for (auto& buffer : commandbuffers) {
+		for (CommandBuffer::CreateCommand& command : buffer->creates) {
+			setupEntity(command.handle, command.uuid, command.name);
+		}
+	}
+	// Group the pools of every thread by component type
+	std::unordered_map<std::type_index, std::vector<CommandBuffer::PoolBase*>> pools;
+	for (auto& buffer : commandbuffers) {
+		for (auto& [type, pool] : buffer->pools) {
+			pools[type].push_back(pool.get());
+		}
+	}
+	for (auto& [type, typepools] : pools) {
+		size_t count = 0;
+		for (CommandBuffer::PoolBase* pool : typepools) {
+			count += pool->getAddCount();
+		}
+		if (count == 0) {
+			continue;
+		}
+		typepools.front()->reserve(*this, count);
+		for (CommandBuffer::PoolBase* pool : typepools) {
+			pool->replayAdds(*this);
+		}
+	}
+	for (auto& [type, typepools] : pools) {
+		for (CommandBuffer::PoolBase* pool : typepools) {
+			pool->replayRemoves(*this);
+		}
+	}
+	for (auto& buffer : commandbuffers) {
+		for (entt::entity handle : buffer->removedentities) {
+			if (registry.valid(handle)) {
+				removeEntity({handle, this});
+			}
+		}
+		buffer->clear();
+	}
+}
+
+void Scene::updateCamera(float deltatime, Entity entity, const TransformComponent& transform, const WorldMatrixComponent& world, CameraComponent& camera) {
+	camera.data.setComponentsUnsafe(transform.position, transform.rotation, transform.scale, world.matrix);
+}
+
 void Scene::updateLight(float deltatime, Entity entity, TransformComponent& transform, LightAmbientComponent& light) {
 	if (light.isenabled && !light.data.isEnabled()) {
 		light.data.enable();
@@ -300,16 +727,243 @@ void Scene::updateLight(float deltatime, Entity entity, TransformComponent& tran
 	}
 }
 
+void Scene::renderSprites(float deltatime) {
+	auto view = registry.view<TransformComponent, SpriteComponent>();
+	if (!isspritebatching) {
+		for (entt::entity handle : view) {
+			renderSprite(deltatime, {handle, this}, view.get<TransformComponent>(handle), view.get<SpriteComponent>(handle));
+		}
+		return;
+	}
+	float viewportheight = renderer->getHeight();
+	spritebatch.begin(renderer->getWidth(), viewportheight);
+	for (entt::entity handle : view) {
+		const TransformComponent& transform = view.get<TransformComponent>(handle);
+		const SpriteComponent& sprite = view.get<SpriteComponent>(handle);
+		if (!sprite.data) {
+			continue;
+		}
+		float width, height;
+		glm::vec4 uv;
+		if (sprite.region.isValid()) {
+			const AtlasRegion& region = sprite.region;
+			float pagesize = static_cast<float>(region.page->getSize());
+			width = transform.scale.x * region.width;
+			height = transform.scale.y * region.height;
+			uv = glm::vec4(region.x, region.y, region.x + region.width, region.y + region.height) / pagesize;
+		} else {
+			width = transform.scale.x * sprite.data->getWidth();
+			height = transform.scale.y * sprite.data->getHeight();
+			uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		}
+		// Same placement as renderSprite, y grows upwards for sprites
+		spritebatch.add(sprite.data.get(), transform.position.x + transform.pivot.x, viewportheight - transform.position.y + transform.pivot.y - height,
+			width, height, transform.pivot.x, transform.pivot.y, getSpriteAngle(transform), uv, sprite.layer);
+	}
+	spritebatch.flush();
+}
+
 void Scene::renderSprite(float deltatime, Entity entity, TransformComponent& transform, SpriteComponent& sprite) {
+	if (!sprite.data) {
+		return;
+	}
 	float viewportheight = renderer->getHeight();
-	float height = transform.scale.y * sprite.data.getHeight();
-	float width = transform.scale.x * sprite.data.getWidth();
-	sprite.data.draw(transform.position.x + transform.pivot.x, viewportheight - transform.position.y + transform.pivot.y - height,
-		width, height, transform.pivot.x, transform.pivot.y, transform.rotation.x);
+	if (sprite.region.isValid()) {
+		const AtlasRegion& region = sprite.region;
+		float height = transform.scale.y * region.height;
+		float width = transform.scale.x * region.width;
+		sprite.data->drawSub(transform.position.x + transform.pivot.x, viewportheight - transform.position.y + transform.pivot.y - height,
+			width, height, region.x, region.y, region.width, region.height, transform.pivot.x, transform.pivot.y, getSpriteAngle(transform));
+		return;
+	}
+	float height = transform.scale.y * sprite.data->getHeight();
+	float width = transform.scale.x * sprite.data->getWidth();
+	sprite.data->draw(transform.position.x + transform.pivot.x, viewportheight - transform.position.y + transform.pivot.y - height,
+		width, height, transform.pivot.x, transform.pivot.y, getSpriteAngle(transform));
+}
+
+void Scene::prepareModels() {
+	for (const ModelDraw& draw : modeldraws) {
+		modelslots[entt::to_entity(draw.handle)] = MODEL_NONE;
+	}
+	modeldraws.clear();
+	auto view = registry.view<WorldMatrixComponent, ModelComponent>();
+	for (entt::entity handle : view) {
+		const ModelComponent& model = view.get<ModelComponent>(handle);
+		if (model.data) {
+			modeldraws.push_back({model.data.get(), handle});
+		}
+	}
+
+	modelculler.clear();
+	modelculler.reserve(modeldraws.size());
+	for (uint32_t i = 0; i < modeldraws.size(); i++) {
+		const ModelDraw& draw = modeldraws[i];
+		uint32_t id = entt::to_entity(draw.handle);
+		if (id >= modelslots.size()) {
+			modelslots.resize(id + 1, MODEL_NONE);
+		}
+		modelslots[id] = i;
+
+		glm::vec4 bounds = view.get<ModelComponent>(draw.handle).bounds;
+		const glm::mat4& matrix = view.get<WorldMatrixComponent>(draw.handle).matrix;
+		if (bounds.w < 0.0f) {
+			modelculler.add(glm::vec3(matrix[3]), std::numeric_limits<float>::infinity());
+			continue;
+		}
+		float scale = std::max({glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))});
+		modelculler.add(glm::vec3(matrix * glm::vec4(glm::vec3(bounds), 1.0f)), bounds.w * scale);
+	}
+}
+
+void Scene::prepareViews() {
+	size_t count = 0;
+	screencamera = entt::null;
+	auto view = registry.view<CameraComponent, TransformComponent, WorldMatrixComponent>();
+	for (entt::entity handle : view) {
+		CameraComponent& component = view.get<CameraComponent>(handle);
+		if (!component.isenabled) {
+			continue;
+		}
+		if (!component.isoffscreen) {
+			// Nothing else would ever show the other on screen cameras
+			if (screencamera != entt::null) {
+				continue;
+			}
+			screencamera = handle;
+		} else if (++component.framessincedraw < component.updateinterval) {
+			continue;
+		}
+		component.framessincedraw = 0;
+		component.allocate(renderer->getScreenWidth(), renderer->getScreenHeight());
+		const TransformComponent& transform = view.get<TransformComponent>(handle);
+		component.updateView(transform.position, view.get<WorldMatrixComponent>(handle).matrix);
+		if (count == renderviews.size()) {
+			renderviews.emplace_back();
+		}
+		renderviews[count++].camera = handle;
+	}
+	// Shrinking keeps the visibility lists of the remaining views allocated
+	renderviews.resize(count);
+
+	auto cull = [this](size_t i) {
+		RenderView& view = renderviews[i];
+		CameraComponent& component = registry.get<CameraComponent>(view.camera);
+		size_t visible = modelculler.cull(component.data.getFrustum(), view.visibility);
+		component.visiblemodelcount = visible;
+		component.culledmodelcount = modeldraws.size() - visible;
+	};
+	if (count > 1 && isparallelupdate) {
+		ThreadPool::getShared().dispatch(count, cull);
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			cull(i);
+		}
+	}
+}
+
+void Scene::queryAabb(const glm::vec3& min, const glm::vec3& max, std::vector<entt::entity>& results) const {
+	spatialindex.queryAabb({min, max}, results);
+}
+
+void Scene::querySphere(const glm::vec3& center, float radius, std::vector<entt::entity>& results) const {
+	spatialindex.querySphere(center, radius, results);
 }
 
-void Scene::renderModel(float deltatime, Entity entity, TransformComponent& transform, ModelComponent& model) {
-	model.data.draw();
+void Scene::queryFrustum(const Frustum& frustum, std::vector<entt::entity>& results) const {
+	spatialindex.queryFrustum(frustum, results);
+}
+
+void Scene::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxdistance, std::vector<entt::entity>& results) const {
+	spatialindex.queryRay(origin, direction, maxdistance, results);
+}
+
+bool Scene::isCulled(entt::entity handle) const {
+	uint32_t id = entt::to_entity(handle);
+	if (!currentview || id >= modelslots.size() || modelslots[id] == MODEL_NONE) {
+		return false;
+	}
+	return !currentview->visibility[modelslots[id]];
+}
+
+void Scene::renderModels(float deltatime) {
+	for (uint32_t i = 0; i < modeldraws.size(); i++) {
+		if (!currentview->visibility[i]) {
+			continue;
+		}
+		// Copies of the same model end up back to back, so they can be
+		// drawn as one instanced run
+		const ModelDraw& draw = modeldraws[i];
+		uint32_t material = drawlist.getMaterialId(draw.model);
+		uint32_t mesh = drawlist.getMeshId(draw.model);
+		const glm::mat4& matrix = registry.get<WorldMatrixComponent>(draw.handle).matrix;
+		drawlist.add(DrawList::makeKey(DrawPass::GEOMETRY, material, mesh, getDrawDepth(glm::vec3(matrix[3]))), i);
+	}
+}
+
+void Scene::submitDraw(DrawPass pass, const void* material, const void* mesh, const glm::vec3& position, std::function<void()> draw) {
+	uint32_t payload = static_cast<uint32_t>(customdraws.size()) | DRAW_CUSTOM;
+	customdraws.push_back(std::move(draw));
+	drawlist.add(DrawList::makeKey(pass, drawlist.getMaterialId(material), drawlist.getMeshId(mesh), getDrawDepth(position)), payload);
+}
+
+float Scene::getDrawDepth(const glm::vec3& position) const {
+	return glm::distance(position, drawposition) / drawfarplane;
+}
+
+void Scene::executeDrawList() {
+	drawlist.sort();
+	const std::vector<DrawCommand>& commands = drawlist.getCommands();
+	glm::vec4 ambient{1.0f};
+	bool isambientready = false;
+	for (size_t first = 0; first < commands.size();) {
+		uint32_t payload = commands[first].payload;
+		if (payload & DRAW_CUSTOM) {
+			customdraws[payload & ~DRAW_CUSTOM]();
+			first++;
+			continue;
+		}
+		gModel* model = modeldraws[payload].model;
+		size_t last = first + 1;
+		while (last < commands.size() && !(commands[last].payload & DRAW_CUSTOM) && modeldraws[commands[last].payload].model == model) {
+			last++;
+		}
+		// Matrices are looked up here since DRAW3D systems may have moved the storage
+		if (ismodelinstancing && last - first > 1 && ModelInstancer::canInstance(*model)) {
+			if (!isambientready) {
+				ambient = getAmbientLight();
+				isambientready = true;
+			}
+			instancematrices.clear();
+			for (size_t i = first; i < last; i++) {
+				instancematrices.push_back(registry.get<WorldMatrixComponent>(modeldraws[commands[i].payload].handle).matrix);
+			}
+			modelinstancer.draw(registry.get<ModelComponent>(modeldraws[payload].handle).data, instancematrices, ambient);
+		} else {
+			for (size_t i = first; i < last; i++) {
+				model->setTransformationMatrix(registry.get<WorldMatrixComponent>(modeldraws[commands[i].payload].handle).matrix);
+				model->draw();
+			}
+		}
+		first = last;
+	}
+	drawlist.clear();
+	customdraws.clear();
+}
+
+glm::vec4 Scene::getAmbientLight() {
+	glm::vec4 ambient{0.0f};
+	bool haslight = false;
+	for (auto [handle, light] : registry.view<LightAmbientComponent>().each()) {
+		if (!light.data.isEnabled()) {
+			continue;
+		}
+		const gColor* color = light.data.getAmbientColor();
+		ambient += glm::vec4(color->r, color->g, color->b, 0.0f);
+		haslight = true;
+	}
+	// Without an ambient light copies are drawn unlit
+	return haslight ? glm::min(ambient, glm::vec4(1.0f)) : glm::vec4(1.0f);
 }
 
 void Scene::updateBehaviors(float deltatime, Entity entity, BehaviorsComponent& behavior) {
@@ -0,0 +1,144 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/SpatialHashGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace gecs {
+
+static constexpr uint32_t SLOT_NONE = std::numeric_limits<uint32_t>::max();
+
+void SpatialHashGrid::setCellSize(float size) {
+	assert(size > 0.0f);
+	// Also rejects NaN
+	if (size > 0.0f) {
+		cellsize = size;
+	}
+}
+
+void SpatialHashGrid::clear() {
+	for (const Entry& entry : entries) {
+		slots[entt::to_entity(entry.handle)] = SLOT_NONE;
+	}
+	entries.clear();
+}
+
+void SpatialHashGrid::add(entt::entity handle, const glm::vec2& min, const glm::vec2& max) {
+	uint32_t id = entt::to_entity(handle);
+	if (id >= slots.size()) {
+		slots.resize(id + 1, SLOT_NONE);
+	}
+	slots[id] = static_cast<uint32_t>(entries.size());
+	entries.push_back({handle, min, max});
+}
+
+glm::ivec2 SpatialHashGrid::getCell(const glm::vec2& position) const {
+	return glm::ivec2(glm::floor(position / cellsize));
+}
+
+uint32_t SpatialHashGrid::getBucket(int x, int y) const {
+	uint32_t hash = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u;
+	return hash & bucketmask;
+}
+
+void SpatialHashGrid::build() {
+	// Twice as many buckets as entries keeps collisions rare
+	uint32_t bucketcount = 1;
+	while (bucketcount < entries.size() * 2) {
+		bucketcount <<= 1;
+	}
+	bucketmask = bucketcount - 1;
+	bucketstarts.assign(bucketcount + 1, 0);
+
+	// Counting sort: count per bucket, turn counts into offsets, then scatter
+	auto forEachCell = [this](const Entry& entry, auto func) {
+		glm::ivec2 first = getCell(entry.min);
+		glm::ivec2 last = getCell(entry.max);
+		for (int y = first.y; y <= last.y; y++) {
+			for (int x = first.x; x <= last.x; x++) {
+				func(x, y);
+			}
+		}
+	};
+	for (const Entry& entry : entries) {
+		forEachCell(entry, [this](int x, int y) {
+			bucketstarts[getBucket(x, y) + 1]++;
+		});
+	}
+	for (uint32_t bucket = 0; bucket < bucketcount; bucket++) {
+		bucketstarts[bucket + 1] += bucketstarts[bucket];
+	}
+	cellentries.resize(bucketstarts[bucketcount]);
+	std::vector<uint32_t> cursor(bucketstarts.begin(), bucketstarts.end() - 1);
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		forEachCell(entries[i], [this, &cursor, i](int x, int y) {
+			cellentries[cursor[getBucket(x, y)]++] = {i, glm::ivec2(x, y)};
+		});
+	}
+}
+
+template<typename Accept>
+void SpatialHashGrid::query(const glm::vec2& min, const glm::vec2& max, Accept accept, std::vector<entt::entity>& results) const {
+	results.clear();
+	if (entries.empty() || bucketstarts.empty()) {
+		return;
+	}
+	glm::ivec2 first = getCell(min);
+	glm::ivec2 last = getCell(max);
+	for (int y = first.y; y <= last.y; y++) {
+		for (int x = first.x; x <= last.x; x++) {
+			glm::ivec2 cell(x, y);
+			uint32_t bucket = getBucket(x, y);
+			for (uint32_t i = bucketstarts[bucket]; i < bucketstarts[bucket + 1]; i++) {
+				// Skip records of other cells hashed into the same bucket
+				if (cellentries[i].cell != cell) {
+					continue;
+				}
+				const Entry& entry = entries[cellentries[i].entry];
+				if (entry.min.x > max.x || entry.max.x < min.x || entry.min.y > max.y || entry.max.y < min.y) {
+					continue;
+				}
+				// Report an entry only from the first cell both rects share, so it comes up once
+				if (getCell(glm::max(entry.min, min)) != cell) {
+					continue;
+				}
+				if (accept(entry)) {
+					results.push_back(entry.handle);
+				}
+			}
+		}
+	}
+}
+
+void SpatialHashGrid::queryRect(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& results) const {
+	query(min, max, [](const Entry&) {
+		return true;
+	}, results);
+}
+
+void SpatialHashGrid::queryRadius(const glm::vec2& center, float radius, std::vector<entt::entity>& results) const {
+	float radiussquared = radius * radius;
+	query(center - radius, center + radius, [&center, radiussquared](const Entry& entry) {
+		glm::vec2 offset = glm::clamp(center, entry.min, entry.max) - center;
+		return glm::dot(offset, offset) <= radiussquared;
+	}, results);
+}
+
+void SpatialHashGrid::queryOverlaps(entt::entity handle, std::vector<entt::entity>& results) const {
+	uint32_t id = entt::to_entity(handle);
+	if (id >= slots.size() || slots[id] == SLOT_NONE || entries[slots[id]].handle != handle) {
+		results.clear();
+		return;
+	}
+	const Entry& self = entries[slots[id]];
+	query(self.min, self.max, [handle](const Entry& entry) {
+		return entry.handle != handle;
+	}, results);
+}
+
+}
@@ -0,0 +1,320 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/SpatialIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace gecs {
+
+// Leaves are enlarged by this fraction of their size plus a constant
+static constexpr float fatfraction = 0.1f;
+static constexpr float fatmargin = 0.05f;
+
+static Aabb fatten(const Aabb& bounds) {
+	glm::vec3 margin = (bounds.max - bounds.min) * fatfraction + fatmargin;
+	return {bounds.min - margin, bounds.max + margin};
+}
+
+// Scratch space of the queries, one per thread so queries can run concurrently
+static thread_local std::vector<int> stack;
+static thread_local std::vector<std::pair<float, entt::entity>> hits;
+
+bool SpatialIndex::update(entt::entity handle, const Aabb& bounds) {
+	uint32_t id = entt::to_entity(handle);
+	if (id >= leaves.size()) {
+		leaves.resize(id + 1, NODE_NONE);
+	}
+	int leaf = leaves[id];
+	if (leaf != NODE_NONE && nodes[leaf].handle == handle) {
+		if (nodes[leaf].bounds.contains(bounds)) {
+			nodes[leaf].box = bounds;
+			return false;
+		}
+		removeLeaf(leaf);
+	} else {
+		leaf = allocateNode();
+		nodes[leaf].handle = handle;
+		leaves[id] = leaf;
+		leafcount++;
+	}
+	nodes[leaf].bounds = fatten(bounds);
+	nodes[leaf].box = bounds;
+	insertLeaf(leaf);
+	return true;
+}
+
+void SpatialIndex::remove(entt::entity handle) {
+	uint32_t id = entt::to_entity(handle);
+	if (id >= leaves.size() || leaves[id] == NODE_NONE || nodes[leaves[id]].handle != handle) {
+		return;
+	}
+	int leaf = leaves[id];
+	removeLeaf(leaf);
+	freeNode(leaf);
+	leaves[id] = NODE_NONE;
+	leafcount--;
+}
+
+void SpatialIndex::clear() {
+	nodes.clear();
+	leaves.clear();
+	root = NODE_NONE;
+	freelist = NODE_NONE;
+	leafcount = 0;
+}
+
+int SpatialIndex::getHeight() const {
+	return root == NODE_NONE ? 0 : nodes[root].height;
+}
+
+template<typename Overlaps>
+void SpatialIndex::query(Overlaps overlaps, std::vector<entt::entity>& results) const {
+	results.clear();
+	if (root == NODE_NONE) {
+		return;
+	}
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!overlaps(node.bounds)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			if (overlaps(node.box)) {
+				results.push_back(node.handle);
+			}
+		} else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+void SpatialIndex::queryAabb(const Aabb& bounds, std::vector<entt::entity>& results) const {
+	query([&bounds](const Aabb& node) {
+		return node.overlaps(bounds);
+	}, results);
+}
+
+void SpatialIndex::querySphere(const glm::vec3& center, float radius, std::vector<entt::entity>& results) const {
+	float radiussquared = radius * radius;
+	query([&center, radiussquared](const Aabb& node) {
+		glm::vec3 closest = glm::clamp(center, node.min, node.max);
+		glm::vec3 offset = closest - center;
+		return glm::dot(offset, offset) <= radiussquared;
+	}, results);
+}
+
+void SpatialIndex::queryFrustum(const Frustum& frustum, std::vector<entt::entity>& results) const {
+	const Plane* planes[] = {&frustum.nearFace, &frustum.farFace, &frustum.leftFace,
+							 &frustum.rightFace, &frustum.topFace, &frustum.bottomFace};
+	query([&planes](const Aabb& node) {
+		// Outside once the corner furthest along a plane normal is behind it
+		for (const Plane* plane : planes) {
+			glm::vec3 corner = glm::mix(node.min, node.max, glm::vec3(glm::greaterThanEqual(plane->normal, glm::vec3(0.0f))));
+			if (glm::dot(plane->normal, corner) - plane->distance < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}, results);
+}
+
+// Slab test, entry distance of the ray into the box or a negative value on a miss
+static float intersectRay(const Aabb& bounds, const glm::vec3& origin, const glm::vec3& inverse, float maxdistance) {
+	glm::vec3 t0 = (bounds.min - origin) * inverse;
+	glm::vec3 t1 = (bounds.max - origin) * inverse;
+	glm::vec3 near = glm::min(t0, t1);
+	glm::vec3 far = glm::max(t0, t1);
+	float enter = std::max({near.x, near.y, near.z, 0.0f});
+	float exit = std::min({far.x, far.y, far.z, maxdistance});
+	return enter <= exit ? enter : -1.0f;
+}
+
+void SpatialIndex::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxdistance, std::vector<entt::entity>& results) const {
+	results.clear();
+	if (root == NODE_NONE) {
+		return;
+	}
+	glm::vec3 inverse = 1.0f / direction;
+	hits.clear();
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		float distance = intersectRay(node.bounds, origin, inverse, maxdistance);
+		if (distance < 0.0f) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			distance = intersectRay(node.box, origin, inverse, maxdistance);
+			if (distance >= 0.0f) {
+				hits.emplace_back(distance, node.handle);
+			}
+		} else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+	std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
+		return a.first < b.first;
+	});
+	results.reserve(hits.size());
+	for (const auto& hit : hits) {
+		results.push_back(hit.second);
+	}
+}
+
+int SpatialIndex::allocateNode() {
+	if (freelist == NODE_NONE) {
+		nodes.emplace_back();
+		return static_cast<int>(nodes.size() - 1);
+	}
+	int index = freelist;
+	freelist = nodes[index].parent;
+	nodes[index] = Node();
+	return index;
+}
+
+void SpatialIndex::freeNode(int index) {
+	nodes[index].parent = freelist;
+	nodes[index].height = -1;
+	nodes[index].handle = entt::null;
+	freelist = index;
+}
+
+void SpatialIndex::insertLeaf(int leaf) {
+	if (root == NODE_NONE) {
+		root = leaf;
+		nodes[root].parent = NODE_NONE;
+		return;
+	}
+
+	// Walk down towards the sibling that grows the total area the least
+	Aabb leafbounds = nodes[leaf].bounds;
+	int index = root;
+	while (!nodes[index].isLeaf()) {
+		const Node& node = nodes[index];
+		float area = node.bounds.getArea();
+		float combinedarea = Aabb::merge(node.bounds, leafbounds).getArea();
+		// Pairing with this node creates a parent, descending grows this node
+		float cost = 2.0f * combinedarea;
+		float inheritedcost = 2.0f * (combinedarea - area);
+		auto descendcost = [&](int child) {
+			const Aabb& bounds = nodes[child].bounds;
+			float merged = Aabb::merge(bounds, leafbounds).getArea();
+			return (nodes[child].isLeaf() ? merged : merged - bounds.getArea()) + inheritedcost;
+		};
+		float leftcost = descendcost(node.left);
+		float rightcost = descendcost(node.right);
+		if (cost < leftcost && cost < rightcost) {
+			break;
+		}
+		index = leftcost < rightcost ? node.left : node.right;
+	}
+
+	int sibling = index;
+	int oldparent = nodes[sibling].parent;
+	int newparent = allocateNode();
+	nodes[newparent].parent = oldparent;
+	nodes[newparent].bounds = Aabb::merge(leafbounds, nodes[sibling].bounds);
+	nodes[newparent].height = nodes[sibling].height + 1;
+	nodes[newparent].left = sibling;
+	nodes[newparent].right = leaf;
+	nodes[sibling].parent = newparent;
+	nodes[leaf].parent = newparent;
+	if (oldparent == NODE_NONE) {
+		root = newparent;
+	} else if (nodes[oldparent].left == sibling) {
+		nodes[oldparent].left = newparent;
+	} else {
+		nodes[oldparent].right = newparent;
+	}
+	refit(nodes[leaf].parent);
+}
+
+void SpatialIndex::removeLeaf(int leaf) {
+	if (leaf == root) {
+		root = NODE_NONE;
+		return;
+	}
+	int parent = nodes[leaf].parent;
+	int grandparent = nodes[parent].parent;
+	int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+	freeNode(parent);
+	nodes[leaf].parent = NODE_NONE;
+	if (grandparent == NODE_NONE) {
+		root = sibling;
+		nodes[sibling].parent = NODE_NONE;
+		return;
+	}
+	if (nodes[grandparent].left == parent) {
+		nodes[grandparent].left = sibling;
+	} else {
+		nodes[grandparent].right = sibling;
+	}
+	nodes[sibling].parent = grandparent;
+	refit(grandparent);
+}
+
+void SpatialIndex::refit(int index) {
+	while (index != NODE_NONE) {
+		index = balance(index);
+		Node& node = nodes[index];
+		node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+		node.bounds = Aabb::merge(nodes[node.left].bounds, nodes[node.right].bounds);
+		index = node.parent;
+	}
+}
+
+// Rotates the taller child up when the subtree at a is out of balance, returns the subtree's new root
+int SpatialIndex::balance(int a) {
+	if (nodes[a].isLeaf() || nodes[a].height < 2) {
+		return a;
+	}
+	int b = nodes[a].left;
+	int c = nodes[a].right;
+	int difference = nodes[c].height - nodes[b].height;
+	if (difference >= -1 && difference <= 1) {
+		return a;
+	}
+	// Lift the taller child p over a, its taller grandchild stays with p
+	int p = difference > 1 ? c : b;
+	int other = p == c ? b : c;
+	int f = nodes[p].left;
+	int g = nodes[p].right;
+
+	nodes[p].left = a;
+	nodes[p].parent = nodes[a].parent;
+	nodes[a].parent = p;
+	if (nodes[p].parent == NODE_NONE) {
+		root = p;
+	} else if (nodes[nodes[p].parent].left == a) {
+		nodes[nodes[p].parent].left = p;
+	} else {
+		nodes[nodes[p].parent].right = p;
+	}
+
+	int keep = nodes[f].height > nodes[g].height ? f : g;
+	int give = keep == f ? g : f;
+	nodes[p].right = keep;
+	if (p == c) {
+		nodes[a].right = give;
+	} else {
+		nodes[a].left = give;
+	}
+	nodes[give].parent = a;
+	nodes[a].bounds = Aabb::merge(nodes[other].bounds, nodes[give].bounds);
+	nodes[a].height = 1 + std::max(nodes[other].height, nodes[give].height);
+	nodes[p].bounds = Aabb::merge(nodes[a].bounds, nodes[keep].bounds);
+	nodes[p].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+	return p;
+}
+
+}
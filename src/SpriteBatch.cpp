@@ -0,0 +1,236 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/SpriteBatch.h"
+
+#include "gRenderObject.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace gecs {
+
+// GLES targets need the es profile and a default precision, like the engine's own shaders
+#if defined(GLIST_MOBILE) || defined(GLIST_WEB)
+#define GECS_GLSL_HEADER "#version 300 es\nprecision mediump float;\n"
+#else
+#define GECS_GLSL_HEADER "#version 330 core\n"
+#endif
+
+static const char* vertexshader = GECS_GLSL_HEADER R"(
+layout (location = 0) in vec2 aPosition;
+layout (location = 1) in vec2 aTexCoords;
+uniform mat4 projection;
+out vec2 TexCoords;
+void main() {
+	TexCoords = aTexCoords;
+	gl_Position = projection * vec4(aPosition, 0.0, 1.0);
+}
+)";
+
+static const char* fragmentshader = GECS_GLSL_HEADER R"(
+in vec2 TexCoords;
+uniform sampler2D image;
+uniform vec4 tint;
+out vec4 FragColor;
+void main() {
+	FragColor = texture(image, TexCoords) * tint;
+}
+)";
+
+SpriteBatch::~SpriteBatch() {
+	if (vao) {
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &ebo);
+	}
+}
+
+void SpriteBatch::begin(float width, float height) {
+	viewportwidth = width;
+	viewportheight = height;
+	xs.clear();
+	ys.clear();
+	widths.clear();
+	heights.clear();
+	pivotxs.clear();
+	pivotys.clear();
+	rotations.clear();
+	uvs.clear();
+	textures.clear();
+	layers.clear();
+}
+
+void SpriteBatch::add(gImage* texture, float x, float y, float width, float height, float pivotx, float pivoty, float rotation,
+					  const glm::vec4& uv, int layer) {
+	// The quad turns around its pivot, so it stays within this circle
+	float reachx = std::max(std::abs(pivotx), std::abs(width - pivotx));
+	float reachy = std::max(std::abs(pivoty), std::abs(height - pivoty));
+	float radius = std::sqrt(reachx * reachx + reachy * reachy);
+	float centerx = x + pivotx;
+	float centery = y + pivoty;
+	if (centerx + radius < 0.0f || centery + radius < 0.0f || centerx - radius > viewportwidth || centery - radius > viewportheight) {
+		return;
+	}
+	xs.push_back(x);
+	ys.push_back(y);
+	widths.push_back(width);
+	heights.push_back(height);
+	pivotxs.push_back(pivotx);
+	pivotys.push_back(pivoty);
+	rotations.push_back(glm::radians(rotation));
+	uvs.push_back(uv);
+	textures.push_back(texture);
+	layers.push_back(layer);
+}
+
+void SpriteBatch::flush() {
+	drawcalls = 0;
+	size_t count = textures.size();
+	if (count == 0) {
+		return;
+	}
+	// Whatever the renderer had bound is put back once the batch is drawn
+	GLint previousprogram = 0;
+	GLint previousvertexarray = 0;
+	GLint previousarraybuffer = 0;
+	GLint previousactivetexture = 0;
+	GLint previousblend[4] = {};
+	GLboolean isblendenabled = glIsEnabled(GL_BLEND);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousprogram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousvertexarray);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousarraybuffer);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &previousactivetexture);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &previousblend[0]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &previousblend[1]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &previousblend[2]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &previousblend[3]);
+
+	if (!vao) {
+		setup();
+	}
+
+	order.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	// Sprites keep the order they were added in within a layer, so overlapping
+	// sprites draw like they would unbatched. Only neighbours sharing a
+	// texture end up in the same draw call.
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		return layers[a] < layers[b];
+	});
+	buildVertices();
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	size_t vertexbytes = vertices.size() * sizeof(Vertex);
+	if (vertexbytes > vbocapacity) {
+		vbocapacity = std::max(vertexbytes, vbocapacity * 2);
+	}
+	// Orphan the old storage so the driver doesn't wait on last frame's draws
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vbocapacity), nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(vertexbytes), vertices.data());
+	if (count > ebocapacity) {
+		ebocapacity = std::max(count, ebocapacity * 2);
+		std::vector<uint32_t> indices(ebocapacity * 6);
+		for (uint32_t quad = 0; quad < ebocapacity; quad++) {
+			uint32_t first = quad * 4;
+			uint32_t* index = &indices[quad * 6];
+			index[0] = first;
+			index[1] = first + 1;
+			index[2] = first + 2;
+			index[3] = first + 2;
+			index[4] = first + 3;
+			index[5] = first;
+		}
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)), indices.data(), GL_STATIC_DRAW);
+	}
+
+	// Sprites are tinted with the renderer color, like gImage::draw
+	const gColor* color = gRenderObject::getRenderer()->getColor();
+	shader->use();
+	shader->setMat4("projection", glm::ortho(0.0f, viewportwidth, viewportheight, 0.0f, -1.0f, 1.0f));
+	shader->setInt("image", 0);
+	shader->setVec4("tint", glm::vec4(color->r, color->g, color->b, color->a));
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glActiveTexture(GL_TEXTURE0);
+	for (size_t first = 0; first < count;) {
+		gImage* texture = textures[order[first]];
+		size_t last = first + 1;
+		while (last < count && textures[order[last]] == texture && layers[order[last]] == layers[order[first]]) {
+			last++;
+		}
+		texture->bind();
+		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>((last - first) * 6), GL_UNSIGNED_INT,
+					   reinterpret_cast<const void*>(first * 6 * sizeof(uint32_t)));
+		texture->unbind();
+		drawcalls++;
+		first = last;
+	}
+
+	glBindVertexArray(static_cast<GLuint>(previousvertexarray));
+	glUseProgram(static_cast<GLuint>(previousprogram));
+	glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(previousarraybuffer));
+	glActiveTexture(static_cast<GLenum>(previousactivetexture));
+	glBlendFuncSeparate(previousblend[0], previousblend[1], previousblend[2], previousblend[3]);
+	if (!isblendenabled) {
+		glDisable(GL_BLEND);
+	}
+}
+
+void SpriteBatch::setup() {
+	shader = std::make_unique<gShader>();
+	shader->loadProgram(vertexshader, fragmentshader);
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, x)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, u)));
+	glBindVertexArray(0);
+}
+
+void SpriteBatch::buildVertices() {
+	size_t count = textures.size();
+	slots.resize(count);
+	for (uint32_t rank = 0; rank < count; rank++) {
+		slots[order[rank]] = rank;
+	}
+	vertices.resize(count * 4);
+	const float* x = xs.data();
+	const float* y = ys.data();
+	const float* width = widths.data();
+	const float* height = heights.data();
+	const float* pivotx = pivotxs.data();
+	const float* pivoty = pivotys.data();
+	const float* rotation = rotations.data();
+	const glm::vec4* uv = uvs.data();
+	const uint32_t* slot = slots.data();
+	Vertex* out = vertices.data();
+	// Branch free so the compiler can vectorize the corner math
+	for (size_t i = 0; i < count; i++) {
+		float c = std::cos(rotation[i]);
+		float s = std::sin(rotation[i]);
+		float left = -pivotx[i];
+		float top = -pivoty[i];
+		float right = width[i] - pivotx[i];
+		float bottom = height[i] - pivoty[i];
+		float originx = x[i] + pivotx[i];
+		float originy = y[i] + pivoty[i];
+		Vertex* quad = out + static_cast<size_t>(slot[i]) * 4;
+		quad[0] = {originx + left * c - top * s, originy + left * s + top * c, uv[i].x, uv[i].y};
+		quad[1] = {originx + right * c - top * s, originy + right * s + top * c, uv[i].z, uv[i].y};
+		quad[2] = {originx + right * c - bottom * s, originy + right * s + bottom * c, uv[i].z, uv[i].w};
+		quad[3] = {originx + left * c - bottom * s, originy + left * s + bottom * c, uv[i].x, uv[i].w};
+	}
+}
+
+}
@@ -0,0 +1,64 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/SystemScheduler.h"
+
+namespace gecs {
+
+void SystemScheduler::add(SystemAccess access, std::function<void(float)> func) {
+	systems.push_back({std::move(access), std::move(func)});
+	isdirty = true;
+}
+
+void SystemScheduler::run(float deltatime, ThreadPool* pool) {
+	// Waves only pay off when they run side by side
+	if (!pool) {
+		for (Entry& system : systems) {
+			system.func(deltatime);
+		}
+		return;
+	}
+	if (isdirty) {
+		buildWaves();
+	}
+	for (const std::vector<size_t>& wave : waves) {
+		if (wave.size() == 1) {
+			for (size_t index : wave) {
+				systems[index].func(deltatime);
+			}
+			continue;
+		}
+		pool->dispatch(wave.size(), [this, &wave, deltatime](size_t i) {
+			systems[wave[i]].func(deltatime);
+		});
+	}
+}
+
+size_t SystemScheduler::getWaveCount() {
+	if (isdirty) {
+		buildWaves();
+	}
+	return waves.size();
+}
+
+void SystemScheduler::buildWaves() {
+	waves.clear();
+	std::vector<size_t> levels(systems.size(), 0);
+	for (size_t i = 0; i < systems.size(); i++) {
+		size_t level = 0;
+		for (size_t j = 0; j < i; j++) {
+			if (systems[i].access.conflictsWith(systems[j].access)) {
+				level = std::max(level, levels[j] + 1);
+			}
+		}
+		levels[i] = level;
+		if (waves.size() <= level) {
+			waves.resize(level + 1);
+		}
+		waves[level].push_back(i);
+	}
+	isdirty = false;
+}
+
+}
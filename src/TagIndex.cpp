@@ -0,0 +1,57 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/TagIndex.h"
+#include "ecs/Components.h"
+
+namespace gecs {
+
+uint32_t TagIndex::intern(const std::string& tag) {
+	auto it = ids.find(tag);
+	if (it != ids.end()) {
+		return it->second;
+	}
+	uint32_t id = static_cast<uint32_t>(buckets.size());
+	buckets.emplace_back();
+	ids.emplace(tag, id);
+	return id;
+}
+
+uint32_t TagIndex::find(const std::string& tag) const {
+	auto it = ids.find(tag);
+	return it != ids.end() ? it->second : null;
+}
+
+void TagIndex::insert(entt::entity entity, TagComponent& component) {
+	component.index = this;
+	component.owner = entity;
+	component.tagid = intern(component.tag);
+	std::vector<entt::entity>& bucket = buckets[component.tagid];
+	component.slot = static_cast<uint32_t>(bucket.size());
+	bucket.push_back(entity);
+}
+
+void TagIndex::erase(TagComponent& component) {
+	if (component.index != this || component.tagid == null) {
+		return;
+	}
+	std::vector<entt::entity>& bucket = buckets[component.tagid];
+	entt::entity last = bucket.back();
+	if (last != component.owner) {
+		bucket[component.slot] = last;
+		registry.get<TagComponent>(last).slot = component.slot;
+	}
+	bucket.pop_back();
+	component.tagid = null;
+	component.index = nullptr;
+}
+
+void TagIndex::rename(TagComponent& component, const std::string& tag) {
+	entt::entity owner = component.owner;
+	erase(component);
+	component.tag = tag;
+	insert(owner, component);
+}
+
+}
@@ -0,0 +1,257 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/TextureAtlas.h"
+
+#include "gRenderObject.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace gecs {
+
+// Empty texels between sprites so filtering doesn't bleed into neighbours
+static constexpr int padding = 1;
+
+AtlasPage::AtlasPage(int size)
+	: size(size), pixels(static_cast<size_t>(size) * size * 4, 0) {
+	skyline.push_back(SkylineNode{0, 0, size});
+}
+
+bool AtlasPage::pack(const unsigned char* source, int width, int height, int channels, int& x, int& y) {
+	int paddedwidth = width + padding;
+	int paddedheight = height + padding;
+	if (takeFreeRect(paddedwidth, paddedheight, x, y)) {
+		// The rect still holds the texels of the sprite released there
+		for (int row = 0; row < paddedheight; row++) {
+			std::memset(pixels.data() + (static_cast<size_t>(y + row) * size + x) * 4, 0, static_cast<size_t>(paddedwidth) * 4);
+		}
+	} else {
+		size_t best = skyline.size();
+		int besttop = INT_MAX;
+		int bestwidth = INT_MAX;
+		// Lowest top edge first, then the narrowest node to keep gaps small
+		for (size_t i = 0; i < skyline.size(); i++) {
+			int nodey = fit(i, paddedwidth, paddedheight);
+			if (nodey < 0) {
+				continue;
+			}
+			int top = nodey + paddedheight;
+			if (top < besttop || (top == besttop && skyline[i].width < bestwidth)) {
+				best = i;
+				besttop = top;
+				bestwidth = skyline[i].width;
+			}
+		}
+		if (best == skyline.size()) {
+			return false;
+		}
+		x = skyline[best].x;
+		y = besttop - paddedheight;
+		addSkylineLevel(best, x, y, paddedwidth, paddedheight);
+	}
+
+	for (int row = 0; row < height; row++) {
+		const unsigned char* in = source + static_cast<size_t>(row) * width * channels;
+		unsigned char* out = pixels.data() + (static_cast<size_t>(y + row) * size + x) * 4;
+		for (int column = 0; column < width; column++, in += channels, out += 4) {
+			switch (channels) {
+			case 1:
+				out[0] = out[1] = out[2] = in[0];
+				out[3] = 255;
+				break;
+			case 2:
+				out[0] = out[1] = out[2] = in[0];
+				out[3] = in[1];
+				break;
+			case 3:
+				out[0] = in[0];
+				out[1] = in[1];
+				out[2] = in[2];
+				out[3] = 255;
+				break;
+			default:
+				out[0] = in[0];
+				out[1] = in[1];
+				out[2] = in[2];
+				out[3] = in[3];
+				break;
+			}
+		}
+	}
+	markDirty(x, y, paddedwidth, paddedheight);
+	return true;
+}
+
+void AtlasPage::release(int x, int y, int width, int height) {
+	freerects.push_back(Rect{x, y, width + padding, height + padding});
+}
+
+void AtlasPage::copyRect(int x, int y, int width, int height, std::vector<unsigned char>& out) const {
+	size_t rowbytes = static_cast<size_t>(width) * 4;
+	out.resize(rowbytes * height);
+	for (int row = 0; row < height; row++) {
+		std::memcpy(out.data() + row * rowbytes, pixels.data() + (static_cast<size_t>(y + row) * size + x) * 4, rowbytes);
+	}
+}
+
+std::shared_ptr<gImage> AtlasPage::getTexture() {
+	if (!texture) {
+		texture = std::make_shared<gImage>();
+		texture->setData(pixels.data(), size, size, 4, false, false);
+	} else if (dirtyminx < dirtymaxx && dirtyminy < dirtymaxy) {
+		// Only the texels packed since the last upload are sent
+		texture->bind();
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, size);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, dirtyminx, dirtyminy, dirtymaxx - dirtyminx, dirtymaxy - dirtyminy, GL_RGBA, GL_UNSIGNED_BYTE,
+						pixels.data() + (static_cast<size_t>(dirtyminy) * size + dirtyminx) * 4);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		texture->unbind();
+	}
+	dirtyminx = dirtyminy = dirtymaxx = dirtymaxy = 0;
+	return texture;
+}
+
+void AtlasPage::markDirty(int x, int y, int width, int height) {
+	if (dirtyminx >= dirtymaxx || dirtyminy >= dirtymaxy) {
+		dirtyminx = x;
+		dirtyminy = y;
+		dirtymaxx = x + width;
+		dirtymaxy = y + height;
+		return;
+	}
+	dirtyminx = std::min(dirtyminx, x);
+	dirtyminy = std::min(dirtyminy, y);
+	dirtymaxx = std::max(dirtymaxx, x + width);
+	dirtymaxy = std::max(dirtymaxy, y + height);
+}
+
+bool AtlasPage::takeFreeRect(int width, int height, int& x, int& y) {
+	// Smallest free rect the sprite fits into
+	size_t best = freerects.size();
+	long long bestarea = LLONG_MAX;
+	for (size_t i = 0; i < freerects.size(); i++) {
+		const Rect& rect = freerects[i];
+		long long area = static_cast<long long>(rect.width) * rect.height;
+		if (rect.width >= width && rect.height >= height && area < bestarea) {
+			best = i;
+			bestarea = area;
+		}
+	}
+	if (best == freerects.size()) {
+		return false;
+	}
+	Rect rect = freerects[best];
+	freerects[best] = freerects.back();
+	freerects.pop_back();
+	x = rect.x;
+	y = rect.y;
+	// Split the rest along the shorter leftover side, so the larger piece stays whole
+	int rightwidth = rect.width - width;
+	int bottomheight = rect.height - height;
+	Rect right{rect.x + width, rect.y, rightwidth, height};
+	Rect bottom{rect.x, rect.y + height, rect.width, bottomheight};
+	if (rightwidth >= bottomheight) {
+		right.height = rect.height;
+		bottom.width = width;
+	}
+	for (const Rect& piece : {right, bottom}) {
+		if (piece.width > 0 && piece.height > 0) {
+			freerects.push_back(piece);
+		}
+	}
+	return true;
+}
+
+int AtlasPage::fit(size_t index, int width, int height) const {
+	int x = skyline[index].x;
+	if (x + width > size) {
+		return -1;
+	}
+	int y = 0;
+	int remaining = width;
+	for (size_t i = index; remaining > 0; i++) {
+		if (i == skyline.size()) {
+			return -1;
+		}
+		y = std::max(y, skyline[i].y);
+		if (y + height > size) {
+			return -1;
+		}
+		remaining -= skyline[i].width;
+	}
+	return y;
+}
+
+void AtlasPage::addSkylineLevel(size_t index, int x, int y, int width, int height) {
+	skyline.insert(skyline.begin() + index, SkylineNode{x, y + height, width});
+	// Cut the nodes now covered by the new level
+	for (size_t i = index + 1; i < skyline.size();) {
+		SkylineNode& node = skyline[i];
+		const SkylineNode& previous = skyline[i - 1];
+		int overlap = previous.x + previous.width - node.x;
+		if (overlap <= 0) {
+			break;
+		}
+		if (overlap < node.width) {
+			node.x += overlap;
+			node.width -= overlap;
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+	}
+	for (size_t i = 0; i + 1 < skyline.size();) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		} else {
+			i++;
+		}
+	}
+}
+
+TextureAtlas::TextureAtlas(int pagesize, int maxspritesize)
+	: pagesize(pagesize), maxspritesize(std::min(maxspritesize, pagesize - padding)) {
+}
+
+AtlasRegion TextureAtlas::pack(const unsigned char* pixels, int width, int height, int channels) {
+	AtlasRegion region;
+	if (!pixels || width <= 0 || height <= 0 || width > maxspritesize || height > maxspritesize) {
+		return region;
+	}
+	if (channels < 1 || channels > 4) {
+		return region;
+	}
+	for (const std::shared_ptr<AtlasPage>& page : pages) {
+		if (page->pack(pixels, width, height, channels, region.x, region.y)) {
+			region.page = page;
+			break;
+		}
+	}
+	if (!region.page) {
+		pages.push_back(std::make_shared<AtlasPage>(pagesize));
+		pages.back()->pack(pixels, width, height, channels, region.x, region.y);
+		region.page = pages.back();
+	}
+	region.width = width;
+	region.height = height;
+	return region;
+}
+
+size_t TextureAtlas::getByteSize() const {
+	size_t bytes = 0;
+	for (const std::shared_ptr<AtlasPage>& page : pages) {
+		bytes += page->getByteSize();
+	}
+	return bytes;
+}
+
+void TextureAtlas::releaseUnusedPages() {
+	pages.erase(std::remove_if(pages.begin(), pages.end(), [](const std::shared_ptr<AtlasPage>& page) {
+		return page.use_count() == 1;
+	}), pages.end());
+}
+
+}
@@ -0,0 +1,128 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace gecs {
+
+// Pool the calling thread works for and its index there
+static thread_local const ThreadPool* threadpool = nullptr;
+static thread_local size_t threadindex = 0;
+
+struct DispatchState {
+	std::atomic<size_t> next{0};
+	std::atomic<size_t> finished{0};
+	size_t count = 0;
+	const std::function<void(size_t)>* job = nullptr;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	// Claims indices until none are left.
+	void work() {
+		size_t done = 0;
+		for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+			(*job)(i);
+			done++;
+		}
+		if (done > 0 && finished.fetch_add(done) + done == count) {
+			std::lock_guard<std::mutex> lock(mutex);
+			condition.notify_all();
+		}
+	}
+};
+
+ThreadPool::ThreadPool(size_t workercount) {
+	workers.reserve(workercount);
+	for (size_t i = 0; i < workercount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isstopping = true;
+	}
+	condition.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::getShared() {
+	static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+size_t ThreadPool::getThreadIndex() {
+	// Per thread lists are sized to the shared pool, other pools map to the caller's slot
+	return threadpool == &getShared() ? threadindex : 0;
+}
+
+void ThreadPool::dispatch(size_t count, const std::function<void(size_t)>& job) {
+	if (count == 0) {
+		return;
+	}
+	if (count == 1 || workers.empty()) {
+		for (size_t i = 0; i < count; i++) {
+			job(i);
+		}
+		return;
+	}
+	auto state = std::make_shared<DispatchState>();
+	state->count = count;
+	state->job = &job;
+	size_t helpers = std::min(count - 1, workers.size());
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < helpers; i++) {
+			tasks.emplace_back([state]() { state->work(); });
+		}
+	}
+	if (helpers == 1) {
+		condition.notify_one();
+	} else {
+		condition.notify_all();
+	}
+	// The caller works too, so nested dispatches from a worker can't starve
+	state->work();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state]() { return state->finished.load() == state->count; });
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	if (workers.empty()) {
+		task();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	condition.notify_one();
+}
+
+void ThreadPool::workerLoop(size_t index) {
+	threadpool = this;
+	threadindex = index;
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return isstopping || !tasks.empty(); });
+			if (isstopping && tasks.empty()) {
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+}
@@ -0,0 +1,102 @@
+//
+// Created by Metehan Gezer on 17/10/2026.
+//
+
+#include "ecs/TransformKernel.h"
+
+namespace gecs {
+
+// Blocks are kept for the next frame
+void TransformKernel::clear() {
+	count = 0;
+}
+
+void TransformKernel::reserve(size_t capacity) {
+	blocks.reserve((capacity + LANES - 1) / LANES);
+}
+
+void TransformKernel::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, const glm::vec3& pivot) {
+	size_t lane = count % LANES;
+	if (count / LANES == blocks.size()) {
+		blocks.emplace_back();
+	}
+	Block& block = blocks[count / LANES];
+	for (int axis = 0; axis < 3; axis++) {
+		block.positions[axis][lane] = position[axis];
+		block.scales[axis][lane] = scale[axis];
+		block.pivots[axis][lane] = pivot[axis];
+	}
+	block.rotations[0][lane] = rotation.x;
+	block.rotations[1][lane] = rotation.y;
+	block.rotations[2][lane] = rotation.z;
+	block.rotations[3][lane] = rotation.w;
+	count++;
+}
+
+void TransformKernel::compute() {
+	// Unused lanes of the last block compute identity matrices
+	size_t blockcount = (count + LANES - 1) / LANES;
+	for (size_t lane = count % LANES; lane > 0 && lane < LANES; lane++) {
+		Block& block = blocks[blockcount - 1];
+		for (int axis = 0; axis < 3; axis++) {
+			block.positions[axis][lane] = 0.0f;
+			block.rotations[axis][lane] = 0.0f;
+			block.scales[axis][lane] = 1.0f;
+			block.pivots[axis][lane] = 0.0f;
+		}
+		block.rotations[3][lane] = 1.0f;
+	}
+	for (size_t b = 0; b < blockcount; b++) {
+		Block& block = blocks[b];
+		const float (&p)[3][LANES] = block.positions;
+		const float (&q)[4][LANES] = block.rotations;
+		const float (&s)[3][LANES] = block.scales;
+		const float (&v)[3][LANES] = block.pivots;
+		float (&m)[12][LANES] = block.matrices;
+		float (&n)[9][LANES] = block.normals;
+		for (size_t i = 0; i < LANES; i++) {
+			// Same as glm::mat3_cast
+			float xx = q[0][i] * q[0][i], yy = q[1][i] * q[1][i], zz = q[2][i] * q[2][i];
+			float xy = q[0][i] * q[1][i], xz = q[0][i] * q[2][i], yz = q[1][i] * q[2][i];
+			float wx = q[3][i] * q[0][i], wy = q[3][i] * q[1][i], wz = q[3][i] * q[2][i];
+			float r00 = 1.0f - 2.0f * (yy + zz), r01 = 2.0f * (xy + wz), r02 = 2.0f * (xz - wy);
+			float r10 = 2.0f * (xy - wz), r11 = 1.0f - 2.0f * (xx + zz), r12 = 2.0f * (yz + wx);
+			float r20 = 2.0f * (xz + wy), r21 = 2.0f * (yz - wx), r22 = 1.0f - 2.0f * (xx + yy);
+
+			float c00 = r00 * s[0][i], c01 = r01 * s[0][i], c02 = r02 * s[0][i];
+			float c10 = r10 * s[1][i], c11 = r11 * s[1][i], c12 = r12 * s[1][i];
+			float c20 = r20 * s[2][i], c21 = r21 * s[2][i], c22 = r22 * s[2][i];
+			m[0][i] = c00; m[1][i] = c01; m[2][i] = c02;
+			m[3][i] = c10; m[4][i] = c11; m[5][i] = c12;
+			m[6][i] = c20; m[7][i] = c21; m[8][i] = c22;
+			// position + pivot - rotated and scaled pivot
+			m[9][i] = p[0][i] + v[0][i] - (c00 * v[0][i] + c10 * v[1][i] + c20 * v[2][i]);
+			m[10][i] = p[1][i] + v[1][i] - (c01 * v[0][i] + c11 * v[1][i] + c21 * v[2][i]);
+			m[11][i] = p[2][i] + v[2][i] - (c02 * v[0][i] + c12 * v[1][i] + c22 * v[2][i]);
+
+			float ix = 1.0f / s[0][i], iy = 1.0f / s[1][i], iz = 1.0f / s[2][i];
+			n[0][i] = r00 * ix; n[1][i] = r01 * ix; n[2][i] = r02 * ix;
+			n[3][i] = r10 * iy; n[4][i] = r11 * iy; n[5][i] = r12 * iy;
+			n[6][i] = r20 * iz; n[7][i] = r21 * iz; n[8][i] = r22 * iz;
+		}
+	}
+}
+
+void TransformKernel::getMatrices(size_t i, glm::mat4& matrix, glm::mat3& normalmatrix) const {
+	const Block& block = blocks[i / LANES];
+	size_t lane = i % LANES;
+	for (int column = 0; column < 4; column++) {
+		for (int row = 0; row < 3; row++) {
+			matrix[column][row] = block.matrices[column * 3 + row][lane];
+		}
+		matrix[column][3] = 0.0f;
+	}
+	matrix[3][3] = 1.0f;
+	for (int column = 0; column < 3; column++) {
+		for (int row = 0; row < 3; row++) {
+			normalmatrix[column][row] = block.normals[column * 3 + row][lane];
+		}
+	}
+}
+
+}